@@ -47,6 +47,7 @@ struct copy_config {
     cargo::dataset::type input_flags = cargo::dataset::type::posix;
     std::vector<std::filesystem::path> outputs;
     cargo::dataset::type output_flags = cargo::dataset::type::posix;
+    cargo::mpio_hints mpio_hints;
 };
 
 copy_config
@@ -94,6 +95,12 @@ parse_command_line(int argc, char* argv[]) {
             ->transform(CLI::CheckedTransformer(dataset_flags_map,
                                                 CLI::ignore_case));
 
+    app.add_option("--mpio-hint", cfg.mpio_hints,
+                   "MPI-IO hint for parallel datasets, overriding\n"
+                   "the one configured in the server (e.g.\n"
+                   "cb_buffer_size 16777216). Can be repeated")
+            ->option_text("KEY VALUE");
+
     try {
         app.parse(argc, argv);
         return cfg;
@@ -137,7 +144,8 @@ main(int argc, char* argv[]) {
                                    tgt, cfg.output_flags};
                        });
 
-        const auto tx = cargo::transfer_datasets(server, inputs, outputs);
+        const auto tx = cargo::transfer_datasets(server, inputs, outputs,
+                                                 cfg.mpio_hints);
 
         if(const auto st = tx.wait(); st.failed()) {
             throw std::runtime_error(st.error().message());
@@ -25,6 +25,7 @@
 #include <fmt/format.h>
 #include <cargo.hpp>
 #include <filesystem>
+#include <optional>
 #include <CLI/CLI.hpp>
 #include <net/client.hpp>
 #include <net/endpoint.hpp>
@@ -33,7 +34,8 @@ struct shaping_config {
     std::string progname;
     std::string server_address;
     std::int64_t tid;
-    std::int16_t shaping;
+    std::optional<std::int16_t> shaping;
+    std::optional<std::uint64_t> rate;
 };
 
 shaping_config
@@ -53,9 +55,20 @@ parse_command_line(int argc, char* argv[]) {
             ->option_text("integer")
             ->required();
 
-    app.add_option("-b,--bw", cfg.shaping, "bw shaping")
-            ->option_text("integer")
-            ->required();
+    auto* shaping = app.add_option_group("shaping");
+
+    shaping->add_option("-b,--bw", cfg.shaping,
+                        "Relative bw shaping: positive values slow the "
+                        "transfer down, negative\nvalues speed it up")
+            ->option_text("integer");
+
+    shaping->add_option("-r,--rate", cfg.rate,
+                        "Limit the bandwidth of the transfer to RATE bytes "
+                        "per second\n(e.g. 500M or 2G). 0 removes the limit")
+            ->option_text("RATE")
+            ->transform(CLI::AsSizeValue(true));
+
+    shaping->require_option(1);
 
 
     try {
@@ -89,7 +102,12 @@ main(int argc, char* argv[]) {
 
         if(const auto result = rpc_client.lookup(address); result.has_value()) {
             const auto& endpoint = result.value();
-            const auto retval = endpoint.call("bw_control", cfg.tid, cfg.shaping);
+            const auto retval =
+                    cfg.rate ? endpoint.call("bw_limit",
+                                             static_cast<std::uint64_t>(cfg.tid),
+                                             *cfg.rate)
+                             : endpoint.call("bw_control", cfg.tid,
+                                             *cfg.shaping);
 
             if(retval.has_value()) {
 
@@ -0,0 +1,61 @@
+################################################################################
+# Copyright 2022-2023, Barcelona Supercomputing Center (BSC), Spain            #
+#                                                                              #
+# This software was partially supported by the EuroHPC-funded project ADMIRE   #
+#   (Project ID: 956748, https://www.admire-eurohpc.eu).                       #
+#                                                                              #
+# This file is part of cargo.                                                  #
+#                                                                              #
+# cargo is free software: you can redistribute it and/or modify                #
+# it under the terms of the GNU General Public License as published by         #
+# the Free Software Foundation, either version 3 of the License, or            #
+# (at your option) any later version.                                          #
+#                                                                              #
+# cargo is distributed in the hope that it will be useful,                     #
+# but WITHOUT ANY WARRANTY; without even the implied warranty of               #
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                #
+# GNU General Public License for more details.                                 #
+#                                                                              #
+# You should have received a copy of the GNU General Public License            #
+# along with cargo.  If not, see <https://www.gnu.org/licenses/>.              #
+#                                                                              #
+# SPDX-License-Identifier: GPL-3.0-or-later                                    #
+################################################################################
+
+
+
+find_path(Zstd_INCLUDE_DIR
+  NAMES zstd.h
+)
+
+find_library(Zstd_LIBRARY
+  NAMES zstd
+)
+
+include(FindPackageHandleStandardArgs)
+find_package_handle_standard_args(
+	Zstd
+	DEFAULT_MSG
+	Zstd_INCLUDE_DIR
+	Zstd_LIBRARY
+)
+
+if(Zstd_FOUND)
+  set(Zstd_LIBRARIES ${Zstd_LIBRARY})
+  set(Zstd_INCLUDE_DIRS ${Zstd_INCLUDE_DIR})
+
+
+  if(NOT TARGET Zstd::Zstd)
+	  add_library(Zstd::Zstd UNKNOWN IMPORTED)
+	  set_target_properties(Zstd::Zstd PROPERTIES
+		IMPORTED_LOCATION "${Zstd_LIBRARY}"
+		INTERFACE_INCLUDE_DIRECTORIES "${Zstd_INCLUDE_DIR}"
+	  )
+	endif()
+endif()
+
+
+mark_as_advanced(
+	Zstd_INCLUDE_DIR
+	Zstd_LIBRARY
+)
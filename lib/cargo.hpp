@@ -28,6 +28,8 @@
 
 #include <cstdint>
 #include <string>
+#include <optional>
+#include <utility>
 #include <vector>
 #include <chrono>
 #include <cargo/error.hpp>
@@ -98,6 +100,13 @@ private:
  */
 enum class transfer_state { pending, running, completed, failed };
 
+/**
+ * MPI-IO hints (such as `cb_nodes`, `cb_buffer_size` or `striping_unit`)
+ * passed as `MPI_Info` key/value pairs when datasets are read or written
+ * collectively. Later pairs override earlier ones with the same key.
+ */
+using mpio_hints = std::vector<std::pair<std::string, std::string>>;
+
 class transfer_status;
 
 /**
@@ -107,7 +116,8 @@ class transfer {
 
     friend transfer
     transfer_datasets(const server& srv, const std::vector<dataset>& sources,
-                      const std::vector<dataset>& targets);
+                      const std::vector<dataset>& targets,
+                      const mpio_hints& hints);
 
     explicit transfer(transfer_id id, server srv) noexcept;
 
@@ -142,6 +152,20 @@ public:
     void
     bw_control (std::int16_t bw_control) const;
 
+    /**
+     * @brief Limit the bandwidth of the transfer.
+     *
+     * The limit applies to the aggregated bandwidth of the transfer and it
+     * is split evenly among the workers that hold parts of the transfer,
+     * or among all the workers of the server if the transfer has not been
+     * dispatched yet.
+     *
+     * @param bytes_per_second The maximum bandwidth in bytes per second, or
+     * 0 to remove the limit.
+     */
+    void
+    bw_limit(std::uint64_t bytes_per_second) const;
+
     /**
      * Wait for the associated transfer to complete.
      *
@@ -179,7 +203,9 @@ class transfer_status {
 
 public:
 
-    transfer_status(std::string name, transfer_state status, float bw, error_code error) noexcept;
+    transfer_status(std::string name, transfer_state status, float bw,
+                    error_code error,
+                    std::optional<std::uint32_t> checksum = {}) noexcept;
     
     /**
      * Get the name of the associated dataset.
@@ -227,11 +253,22 @@ public:
     [[nodiscard]] float
     bw() const;
 
+    /**
+     * Retrieve the CRC32C checksum of the dataset.
+     *
+     * @return The CRC32C of the whole dataset, computed while it was
+     * transferred, if the transfer has completed and the server verifies
+     * the data it transfers. An empty value otherwise.
+     */
+    [[nodiscard]] std::optional<std::uint32_t>
+    checksum() const noexcept;
+
 private:
     std::string m_name;
     transfer_state m_state;
     float m_bw;
     error_code m_error;
+    std::optional<std::uint32_t> m_checksum;
 };
 
 
@@ -248,6 +285,22 @@ transfer
 transfer_datasets(const server& srv, const std::vector<dataset>& sources,
                   const std::vector<dataset>& targets);
 
+/**
+ * Request the transfer of a dataset collection, tuning the MPI-IO layer
+ * used for its parallel datasets.
+ *
+ * @param srv The Cargo server that should execute the transfer.
+ * @param sources The input datasets that should be transferred.
+ * @param targets The output datasets that should be generated.
+ * @param hints The MPI-IO hints for the transfer, applied after (and thus
+ * overriding) those configured in the server.
+ * @return A transfer
+ */
+transfer
+transfer_datasets(const server& srv, const std::vector<dataset>& sources,
+                  const std::vector<dataset>& targets,
+                  const mpio_hints& hints);
+
 /**
  * Request the transfer of a single dataset.
  * This function is a convenience wrapper around the previous one.
@@ -27,6 +27,8 @@
 
 #include <iomanip>
 #include <vector>
+#include <string>
+#include <utility>
 #include <string_view>
 #include <optional>
 #include <fmt/format.h>
@@ -103,6 +105,24 @@ struct fmt::formatter<cargo::transfer_state> : formatter<std::string_view> {
     }
 };
 
+// cargo::mpio_hints
+template <>
+struct fmt::formatter<std::vector<std::pair<std::string, std::string>>>
+    : formatter<std::string_view> {
+    // parse is inherited from formatter<string_view>.
+    template <typename FormatContext>
+    auto
+    format(const std::vector<std::pair<std::string, std::string>>& v,
+           FormatContext& ctx) const {
+        std::vector<std::string> hints;
+        for(const auto& [key, value] : v) {
+            hints.push_back(fmt::format("{}={}", key, value));
+        }
+        const auto str = fmt::format("[{}]", fmt::join(hints, ", "));
+        return formatter<std::string_view>::format(str, ctx);
+    }
+};
+
 template <typename T>
 struct fmt::formatter<std::optional<T>> : formatter<std::string_view> {
     // parse is inherited from formatter<string_view>.
@@ -168,9 +168,10 @@ transfer::statuses() const {
             // (for some reason it asks for a public constructor)
 
             std::vector<transfer_status> v_statuses;
-            for(const auto& [name, s, bw, ec] : v) {
+            for(const auto& [name, s, bw, ec, checksum] : v) {
                 v_statuses.emplace_back(transfer_status{
-                        name, s, bw, ec.value_or(error_code::success)});
+                        name, s, bw, ec.value_or(error_code::success),
+                        checksum});
             }
 
             return v_statuses;
@@ -215,13 +216,51 @@ transfer::bw_control(std::int16_t bw_control) const {
     throw std::runtime_error("rpc lookup failed");
 }
 
+void
+transfer::bw_limit(std::uint64_t bytes_per_second) const {
+
+    using proto::generic_response;
+
+    network::client rpc_client{m_srv.protocol()};
+    const auto rpc = network::rpc_info::create("bw_limit", m_srv.address());
+    using response_type = generic_response<error_code>;
+
+    if(const auto lookup_rv = rpc_client.lookup(m_srv.address());
+       lookup_rv.has_value()) {
+        const auto& endp = lookup_rv.value();
+
+        LOGGER_INFO("rpc {:<} body: {{tid: {}, bytes_per_second: {}}}", rpc,
+                    m_id, bytes_per_second);
+
+        if(const auto call_rv = endp.call(rpc.name(), m_id, bytes_per_second);
+           call_rv.has_value()) {
+
+            const response_type resp{call_rv.value()};
+
+            LOGGER_EVAL(resp.error_code(), ERROR, INFO,
+                        "rpc {:>} body: {{retval: {}}} [op_id: {}]", rpc,
+                        resp.error_code(), resp.op_id());
+
+            if(resp.error_code()) {
+                throw std::runtime_error(
+                        fmt::format("rpc call failed: {}", resp.error_code()));
+            }
+        }
+        return;
+    }
+
+    throw std::runtime_error("rpc lookup failed");
+}
+
 transfer_status::transfer_status(transfer_state status, float bw,
                                  error_code error) noexcept
     : m_name(""), m_state(status), m_bw(bw), m_error(error) {}
 
 transfer_status::transfer_status(std::string name, transfer_state status,
-                                 float bw, error_code error) noexcept
-    : m_name(name), m_state(status), m_bw(bw), m_error(error) {}
+                                 float bw, error_code error,
+                                 std::optional<std::uint32_t> checksum) noexcept
+    : m_name(name), m_state(status), m_bw(bw), m_error(error),
+      m_checksum(checksum) {}
 
 transfer_state
 transfer_status::state() const noexcept {
@@ -248,6 +287,11 @@ transfer_status::bw() const {
     return m_bw;
 }
 
+std::optional<std::uint32_t>
+transfer_status::checksum() const noexcept {
+    return m_checksum;
+}
+
 error_code
 transfer_status::error() const {
     switch(m_state) {
@@ -263,6 +307,13 @@ transfer_status::error() const {
 transfer
 transfer_datasets(const server& srv, const std::vector<dataset>& sources,
                   const std::vector<dataset>& targets) {
+    return transfer_datasets(srv, sources, targets, mpio_hints{});
+}
+
+transfer
+transfer_datasets(const server& srv, const std::vector<dataset>& sources,
+                  const std::vector<dataset>& targets,
+                  const mpio_hints& hints) {
 
     if(sources.size() != targets.size()) {
         throw std::runtime_error(
@@ -277,10 +328,11 @@ transfer_datasets(const server& srv, const std::vector<dataset>& sources,
        lookup_rv.has_value()) {
         const auto& endp = lookup_rv.value();
 
-        LOGGER_INFO("rpc {:<} body: {{sources: {}, targets: {}}}", rpc, sources,
-                    targets);
+        LOGGER_INFO("rpc {:<} body: {{sources: {}, targets: {}, hints: {}}}",
+                    rpc, sources, targets, hints);
 
-        if(const auto call_rv = endp.call(rpc.name(), sources, targets);
+        if(const auto call_rv =
+                   endp.call(rpc.name(), sources, targets, hints);
            call_rv.has_value()) {
 
             const response_with_id resp{call_rv.value()};
@@ -0,0 +1,93 @@
+/******************************************************************************
+ * Copyright 2022-2023, Barcelona Supercomputing Center (BSC), Spain
+ *
+ * This software was partially supported by the EuroHPC-funded project ADMIRE
+ *   (Project ID: 956748, https://www.admire-eurohpc.eu).
+ *
+ * This file is part of Cargo.
+ *
+ * Cargo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cargo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cargo.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *****************************************************************************/
+
+#include "block_dispenser.hpp"
+#include <algorithm>
+
+namespace cargo {
+
+void
+block_dispenser::enable(bool enabled) {
+    abt::unique_lock lock(m_mutex);
+    m_enabled = enabled;
+}
+
+std::uint64_t
+block_dispenser::add(std::uint64_t tid, std::uint32_t seqno,
+                     std::uint64_t total_blocks, std::size_t workers) {
+
+    abt::unique_lock lock(m_mutex);
+
+    // with at most a block per worker there is nothing to balance
+    if(!m_enabled || workers < 2 || total_blocks <= workers) {
+        return 0;
+    }
+
+    const std::uint64_t chunk = std::clamp<std::uint64_t>(
+            total_blocks / (workers * chunks_per_worker), 1, max_chunk_blocks);
+
+    // the first chunk of each worker is implicit
+    m_files[{tid, seqno}] = file_state{
+            total_blocks, chunk,
+            std::min<std::uint64_t>(chunk * workers, total_blocks), workers};
+
+    return chunk;
+}
+
+std::pair<std::uint64_t, std::uint64_t>
+block_dispenser::claim(std::uint64_t tid, std::uint32_t seqno) {
+
+    abt::unique_lock lock(m_mutex);
+
+    const auto it = m_files.find({tid, seqno});
+
+    if(it == m_files.end()) {
+        return {0, 0};
+    }
+
+    auto& f = it->second;
+
+    if(f.next_block == f.total_blocks) {
+        // each worker claims until it finds the file exhausted, so the
+        // file can be forgotten once all of them have done so
+        if(--f.workers == 0) {
+            m_files.erase(it);
+        }
+        return {0, 0};
+    }
+
+    const std::uint64_t first = f.next_block;
+    const std::uint64_t count = std::min(f.chunk, f.total_blocks - first);
+
+    f.next_block += count;
+    return {first, count};
+}
+
+void
+block_dispenser::remove(std::uint64_t tid, std::uint32_t seqno) {
+    abt::unique_lock lock(m_mutex);
+    m_files.erase({tid, seqno});
+}
+
+} // namespace cargo
@@ -0,0 +1,97 @@
+/******************************************************************************
+ * Copyright 2022-2023, Barcelona Supercomputing Center (BSC), Spain
+ *
+ * This software was partially supported by the EuroHPC-funded project ADMIRE
+ *   (Project ID: 956748, https://www.admire-eurohpc.eu).
+ *
+ * This file is part of Cargo.
+ *
+ * Cargo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cargo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cargo.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *****************************************************************************/
+
+#ifndef CARGO_BLOCK_DISPENSER_HPP
+#define CARGO_BLOCK_DISPENSER_HPP
+
+#include <cstdint>
+#include <map>
+#include <utility>
+#include "shared_mutex.hpp"
+
+namespace cargo {
+
+/**
+ * Hands out the blocks of the files whose blocks are distributed dynamically
+ * among the workers.
+ *
+ * Each worker starts with a chunk of consecutive blocks: worker `w` gets the
+ * blocks in `[w * chunk, (w + 1) * chunk)`. Once it is about to run out of
+ * blocks, it claims the next chunk of the file from the master. Workers that
+ * go faster thus claim more chunks, and a straggler only delays the transfer
+ * by the chunk it is working on. The chunk size is chosen so that each
+ * worker claims a few chunks of a file on average.
+ */
+class block_dispenser {
+
+public:
+    static constexpr std::uint64_t chunks_per_worker = 8;
+    static constexpr std::uint64_t max_chunk_blocks = 1024;
+
+    void
+    enable(bool enabled);
+
+    /**
+     * @brief Start distributing the `total_blocks` blocks of file `seqno` of
+     * transfer `tid` among `workers` workers.
+     * @return The number of blocks in each chunk, or 0 if the blocks of the
+     * file should be assigned statically instead
+     */
+    std::uint64_t
+    add(std::uint64_t tid, std::uint32_t seqno, std::uint64_t total_blocks,
+        std::size_t workers);
+
+    /**
+     * @brief Hand out the next chunk of file `seqno` of transfer `tid`.
+     * @return The first block of the chunk and its number of blocks, which is
+     * 0 once all the blocks of the file have been handed out
+     */
+    std::pair<std::uint64_t, std::uint64_t>
+    claim(std::uint64_t tid, std::uint32_t seqno);
+
+    /**
+     * @brief Stop distributing the blocks of file `seqno` of transfer `tid`,
+     * once it has completed or failed. Workers whose operation failed never
+     * claim the end of the file, so its state would be kept otherwise.
+     */
+    void
+    remove(std::uint64_t tid, std::uint32_t seqno);
+
+private:
+    struct file_state {
+        std::uint64_t total_blocks;
+        std::uint64_t chunk;
+        std::uint64_t next_block;
+        // workers that have not been told that the file has no blocks left
+        std::size_t workers;
+    };
+
+    bool m_enabled = true;
+    mutable abt::shared_mutex m_mutex;
+    std::map<std::pair<std::uint64_t, std::uint32_t>, file_state> m_files;
+};
+
+} // namespace cargo
+
+#endif // CARGO_BLOCK_DISPENSER_HPP
@@ -0,0 +1,202 @@
+/******************************************************************************
+ * Copyright 2022-2023, Barcelona Supercomputing Center (BSC), Spain
+ *
+ * This software was partially supported by the EuroHPC-funded project ADMIRE
+ *   (Project ID: 956748, https://www.admire-eurohpc.eu).
+ *
+ * This file is part of Cargo.
+ *
+ * Cargo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cargo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cargo.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *****************************************************************************/
+
+
+#include "block_size_tuner.hpp"
+#include <algorithm>
+#include <bit>
+#include "logger/logger.hpp"
+
+namespace {
+
+// weight of a new bandwidth sample in the moving average
+constexpr double sample_weight = 0.25;
+// samples needed before a block size can replace the current one
+constexpr std::uint64_t min_samples = 3;
+// relative improvement needed to switch to a different block size
+constexpr double hysteresis = 0.05;
+
+bool
+is_parallel(cargo::dataset::type t) {
+    return t == cargo::dataset::type::parallel;
+}
+
+// The multiple of `stripe_size` closest to `block_size` from below, but at
+// least one stripe
+std::uint64_t
+align(std::uint64_t block_size, std::uint64_t stripe_size) {
+    if(stripe_size == 0) {
+        return block_size;
+    }
+    return std::max<std::uint64_t>(block_size / stripe_size, 1) * stripe_size;
+}
+
+} // namespace
+
+namespace cargo {
+
+block_size_tuner::block_size_tuner(std::uint64_t default_block_size)
+    : m_default_block_size(default_block_size) {}
+
+void
+block_size_tuner::enable(bool enabled) {
+    abt::unique_lock lock(m_mutex);
+    m_enabled = enabled;
+}
+
+std::uint64_t
+block_size_tuner::block_size(std::size_t index) {
+    return min_block_size << index;
+}
+
+std::size_t
+block_size_tuner::index_of(std::uint64_t block_size) {
+    block_size = std::clamp(block_size, min_block_size, max_block_size);
+    return std::bit_width(block_size / min_block_size) - 1;
+}
+
+block_size_tuner::tier_state&
+block_size_tuner::state(const tier& key) {
+
+    if(const auto it = m_tiers.find(key); it != m_tiers.end()) {
+        return it->second;
+    }
+
+    // start from the configured block size
+    std::size_t current = index_of(m_default_block_size);
+
+    if(is_parallel(key.first) || is_parallel(key.second)) {
+        current = std::max(current, index_of(min_parallel_block_size));
+    }
+
+    return m_tiers.emplace(key, tier_state{current}).first->second;
+}
+
+std::uint64_t
+block_size_tuner::assign(std::uint64_t tid, std::uint32_t seqno,
+                         dataset::type input, dataset::type output,
+                         std::optional<std::uint64_t> file_size,
+                         std::size_t workers, std::uint64_t stripe_size) {
+
+    abt::unique_lock lock(m_mutex);
+
+    if(!m_enabled) {
+        return align(m_default_block_size, stripe_size);
+    }
+
+    const tier key{input, output};
+    auto& s = state(key);
+
+    std::size_t lowest = is_parallel(input) || is_parallel(output)
+                                 ? index_of(min_parallel_block_size)
+                                 : 0;
+
+    // the power-of-two block sizes not smaller than a power-of-two stripe are
+    // all multiples of it, so they can still be tuned
+    const bool tunable =
+            std::has_single_bit(stripe_size) && stripe_size <= max_block_size;
+
+    if(tunable) {
+        lowest = std::max(lowest, index_of(stripe_size));
+    }
+
+    std::size_t index = std::max(s.current, lowest);
+
+    // periodically try the neighbouring block sizes, alternating between
+    // the larger and the smaller one
+    if(++s.files % explore_period == 0) {
+        if((s.files / explore_period) % 2 == 1) {
+            index = std::min(index + 1, num_sizes - 1);
+        } else if(index > lowest) {
+            --index;
+        }
+    }
+
+    // a block per worker is enough for small files
+    if(file_size) {
+        const std::uint64_t share =
+                (*file_size / 1024 + workers - 1) / std::max<std::size_t>(workers, 1);
+        const std::size_t largest_useful = std::max(
+                index_of(std::bit_ceil(std::max<std::uint64_t>(share, 1))),
+                lowest);
+
+        if(largest_useful < index) {
+            return align(block_size(largest_useful), stripe_size);
+        }
+    }
+
+    // other stripe sizes are not tuned: their bandwidth would be credited to
+    // a block size that was not used
+    if(stripe_size != 0 && !tunable) {
+        return align(block_size(index), stripe_size);
+    }
+
+    m_assignments[{tid, seqno}] = assignment{key, index};
+    return block_size(index);
+}
+
+void
+block_size_tuner::observe(std::uint64_t tid, std::uint32_t seqno, float bw) {
+
+    if(bw <= 0.0f) {
+        return;
+    }
+
+    abt::unique_lock lock(m_mutex);
+
+    const auto it = m_assignments.find({tid, seqno});
+
+    if(it == m_assignments.end()) {
+        return;
+    }
+
+    const auto& [key, index] = it->second;
+    auto& s = state(key);
+
+    s.bw[index] = s.samples[index] == 0
+                          ? bw
+                          : (1.0 - sample_weight) * s.bw[index] +
+                                    sample_weight * bw;
+    ++s.samples[index];
+
+    if(index == s.current || s.samples[index] < min_samples ||
+       s.bw[index] <= s.bw[s.current] * (1.0 + hysteresis)) {
+        return;
+    }
+
+    LOGGER_INFO("Block size for {} -> {} transfers: {} KiB -> {} KiB "
+                "({:.2f} -> {:.2f} MiB/s)",
+                static_cast<int>(key.first), static_cast<int>(key.second),
+                block_size(s.current), block_size(index), s.bw[s.current],
+                s.bw[index]);
+    s.current = index;
+}
+
+void
+block_size_tuner::finish(std::uint64_t tid, std::uint32_t seqno) {
+    abt::unique_lock lock(m_mutex);
+    m_assignments.erase({tid, seqno});
+}
+
+} // namespace cargo
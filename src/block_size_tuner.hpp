@@ -0,0 +1,136 @@
+/******************************************************************************
+ * Copyright 2022-2023, Barcelona Supercomputing Center (BSC), Spain
+ *
+ * This software was partially supported by the EuroHPC-funded project ADMIRE
+ *   (Project ID: 956748, https://www.admire-eurohpc.eu).
+ *
+ * This file is part of Cargo.
+ *
+ * Cargo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cargo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cargo.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *****************************************************************************/
+
+
+#ifndef CARGO_BLOCK_SIZE_TUNER_HPP
+#define CARGO_BLOCK_SIZE_TUNER_HPP
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <utility>
+#include "cargo.hpp"
+#include "shared_mutex.hpp"
+
+namespace cargo {
+
+/**
+ * Chooses the block size used by the workers to transfer each file.
+ *
+ * Block sizes are powers of two between `min_block_size` and
+ * `max_block_size` (in KiB), so they are aligned to pages and filesystem
+ * blocks. For each pair of input and output dataset types, the tuner keeps an
+ * exponential moving average of the per-block bandwidth reported by the
+ * workers for each block size, and uses the best one found so far. Every
+ * `explore_period` files, a neighbouring size is tried instead so that the
+ * estimate adapts when the workload changes.
+ *
+ * Files that are too small for a full block per worker get a smaller block
+ * size so that buffers are not wasted, and their bandwidth is not used to
+ * tune the others. Transfers involving a parallel filesystem never use
+ * blocks smaller than `min_parallel_block_size`, so that requests cover
+ * whole stripes.
+ *
+ * If the output file system reports its stripe size, blocks are also
+ * multiples of a stripe. Since block `i` of a file goes to worker
+ * `i % workers` (or to the worker that claims it), each stripe is then
+ * written by a single worker and workers do not contend for its locks.
+ */
+class block_size_tuner {
+
+public:
+    static constexpr std::uint64_t min_block_size = 64;             // KiB
+    static constexpr std::uint64_t min_parallel_block_size = 1024;  // KiB
+    static constexpr std::uint64_t max_block_size = 64 * 1024;      // KiB
+    static constexpr std::uint64_t explore_period = 8;
+
+    explicit block_size_tuner(std::uint64_t default_block_size);
+
+    void
+    enable(bool enabled);
+
+    /**
+     * @brief Choose the block size (in KiB) for file `seqno` of transfer
+     * `tid`.
+     * @param file_size The size of the file in bytes, if known
+     * @param workers The number of workers sharing the file
+     * @param stripe_size The stripe size of the output file (in KiB), or 0
+     * if it is unknown
+     */
+    std::uint64_t
+    assign(std::uint64_t tid, std::uint32_t seqno, dataset::type input,
+           dataset::type output, std::optional<std::uint64_t> file_size,
+           std::size_t workers, std::uint64_t stripe_size = 0);
+
+    /**
+     * @brief Feed a bandwidth sample (in MiB/s) reported by a worker while
+     * transferring file `seqno` of transfer `tid`.
+     */
+    void
+    observe(std::uint64_t tid, std::uint32_t seqno, float bw);
+
+    /**
+     * @brief Stop tracking file `seqno` of transfer `tid`.
+     */
+    void
+    finish(std::uint64_t tid, std::uint32_t seqno);
+
+private:
+    static constexpr std::size_t num_sizes = 11; // 64 KiB ... 64 MiB
+
+    using tier = std::pair<dataset::type, dataset::type>;
+
+    struct tier_state {
+        std::size_t current;
+        std::uint64_t files = 0;
+        std::array<double, num_sizes> bw{};
+        std::array<std::uint64_t, num_sizes> samples{};
+    };
+
+    struct assignment {
+        tier key;
+        std::size_t index;
+    };
+
+    static std::uint64_t
+    block_size(std::size_t index);
+
+    static std::size_t
+    index_of(std::uint64_t block_size);
+
+    tier_state&
+    state(const tier& key);
+
+    bool m_enabled = true;
+    std::uint64_t m_default_block_size;
+    mutable abt::shared_mutex m_mutex;
+    std::map<tier, tier_state> m_tiers;
+    std::map<std::pair<std::uint64_t, std::uint32_t>, assignment>
+            m_assignments;
+};
+
+} // namespace cargo
+
+#endif // CARGO_BLOCK_SIZE_TUNER_HPP
@@ -36,6 +36,7 @@
 #include <version.hpp>
 #include "master.hpp"
 #include "worker/worker.hpp"
+#include <posix_file/container.hpp>
 #include "env.hpp"
 
 namespace fs = std::filesystem;
@@ -50,6 +51,21 @@ struct cargo_config {
     std::optional<fs::path> output_file;
     std::string address;
     std::uint64_t blocksize;
+    std::uint64_t memory_limit;
+    std::size_t pipeline_depth;
+    std::size_t io_threads;
+    std::uint64_t small_file_threshold;
+    std::uint64_t stripe_threshold;
+    bool disable_io_uring = false;
+    bool incremental = false;
+    bool verify = false;
+    bool compress = false;
+    std::optional<fs::path> checksum_manifest;
+    std::optional<fs::path> journal_dir;
+    cargo::mpio_hints mpio_hints;
+    std::size_t status_tree_arity;
+    bool disable_autotuning = false;
+    bool disable_work_stealing = false;
 };
 
 cargo_config
@@ -82,6 +98,95 @@ parse_command_line(int argc, char* argv[]) {
             ->option_text("BLOCKSIZE")
             ->default_val(512);
 
+    app.add_option("-m,--memory-limit", cfg.memory_limit,
+                   "Maximum amount of memory (in MiB) that each worker may "
+                   "buffer for a\nparallel (MPI-IO) transfer. Larger files are "
+                   "transferred in several\ncollective rounds. Defaults to 0 "
+                   "(no limit).\n")
+            ->option_text("MEMORY_LIMIT")
+            ->default_val(0);
+
+    app.add_option("-p,--pipeline-depth", cfg.pipeline_depth,
+                   "Number of blocks kept in flight by each worker for a "
+                   "sequential\ntransfer. Defaults to 4.\n")
+            ->option_text("DEPTH")
+            ->default_val(4);
+
+    app.add_option("-t,--io-threads", cfg.io_threads,
+                   "Number of I/O threads in each worker that transfer "
+                   "blocks\nconcurrently. Defaults to 4.\n")
+            ->option_text("THREADS")
+            ->default_val(4);
+
+    app.add_option("-s,--small-file-threshold", cfg.small_file_threshold,
+                   "Files of up to this many kb are grouped in batches, each "
+                   "transferred\nby a single worker, unless they are read or "
+                   "written with MPI-IO.\n0 disables batching. Defaults to "
+                   "1024 (kb).\n")
+            ->option_text("SIZE")
+            ->default_val(1024);
+
+    app.add_option("--stripe-threshold", cfg.stripe_threshold,
+                   "Files of up to this many MiB are assigned whole to a "
+                   "worker, balancing\nthe bytes sent to each worker, "
+                   "while larger files are split among\nall of them. 0 "
+                   "splits all files. Defaults to 0 (MiB).\n")
+            ->option_text("SIZE")
+            ->default_val(0);
+
+    app.add_flag("--disable-autotuning", cfg.disable_autotuning,
+                 "Always use BLOCKSIZE instead of adapting the block size of "
+                 "each file\nto its size and to the observed bandwidth.\n");
+
+    app.add_flag("--disable-work-stealing", cfg.disable_work_stealing,
+                 "Split the blocks of each sequential transfer evenly among "
+                 "workers\ninstead of handing them out as workers go.\n");
+
+    app.add_flag("--disable-io-uring", cfg.disable_io_uring,
+                 "Do not use io_uring for block I/O on POSIX files, even if "
+                 "the kernel\nsupports it. I/O threads are used instead.\n");
+
+    app.add_flag("--incremental", cfg.incremental,
+                 "Only write the blocks that differ from those already in "
+                 "the output\nfiles, which are read back for comparison.\n");
+
+    app.add_flag("--verify", cfg.verify,
+                 "Checksum each block (CRC32C) as it is read and check it "
+                 "against the\noutput file once written. The digest of each "
+                 "file is reported\nwith its status.\n");
+
+    app.add_flag("--compress", cfg.compress,
+                 "Store the files staged out from an ad-hoc file system to a "
+                 "POSIX\ndataset as zstd block-compressed containers, and "
+                 "decompress\ncontainers when staging them in. Disables "
+                 "work stealing.\n");
+
+    app.add_option("--checksum-manifest", cfg.checksum_manifest,
+                   "Append a line with the digest and the name of each "
+                   "verified file\nto FILENAME.\n")
+            ->option_text("FILENAME");
+
+    app.add_option("--journal-dir", cfg.journal_dir,
+                   "Journal the blocks completed in each output file under "
+                   "DIRECTORY, which\nmust be shared by all the workers, so "
+                   "that an interrupted transfer\nof the same files skips "
+                   "them. Only sequential transfers are\njournaled.\n")
+            ->option_text("DIRECTORY");
+
+    app.add_option("--mpio-hint", cfg.mpio_hints,
+                   "Pass the MPI-IO hint KEY with VALUE (e.g. cb_nodes 8) "
+                   "when opening\nfiles collectively. Can be repeated. "
+                   "Transfers may override\nthese hints with their own.\n")
+            ->option_text("KEY VALUE");
+
+    app.add_option("--status-tree-arity", cfg.status_tree_arity,
+                   "Workers report the status of transfers through a tree "
+                   "with this\narity, reducing the updates of their "
+                   "subtrees, instead of reporting\nto the master directly. "
+                   "0 disables the tree. Defaults to 0.\n")
+            ->option_text("ARITY")
+            ->default_val(0);
+
     app.add_flag_function(
             "-v,--version",
             [&](auto /*count*/) {
@@ -111,6 +216,13 @@ main(int argc, char* argv[]) {
 
     cargo_config cfg = parse_command_line(argc, argv);
 
+    if(cfg.compress && !posix_file::block_container::supported()) {
+        fmt::print(stderr, "{}: --compress requires Cargo to be built with "
+                           "zstd support\n",
+                   cfg.progname);
+        return EXIT_FAILURE;
+    }
+
     // Initialize the MPI environment
     mpi::environment env;
     mpi::communicator world;
@@ -120,6 +232,22 @@ main(int argc, char* argv[]) {
             cargo::master_server srv{cfg.progname, cfg.address, cfg.daemonize,
                                      fs::current_path(), cfg.blocksize};
 
+            srv.set_block_size_autotuning(!cfg.disable_autotuning);
+            srv.set_small_file_threshold(cfg.small_file_threshold * 1024);
+            srv.set_stripe_threshold(cfg.stripe_threshold * 1024 * 1024);
+            // the master does not know the block layout of compressed
+            // containers
+            srv.set_work_stealing(!cfg.disable_work_stealing &&
+                                  !cfg.compress);
+
+            if(cfg.checksum_manifest) {
+                srv.set_checksum_manifest(*cfg.checksum_manifest);
+            }
+
+            if(cfg.journal_dir) {
+                srv.set_journal_dir(*cfg.journal_dir);
+            }
+
             if(cfg.output_file) {
                 srv.configure_logger(logger::logger_type::file,
                                      get_process_output_file(*cfg.output_file));
@@ -135,6 +263,20 @@ main(int argc, char* argv[]) {
             }
 
             w.set_block_size(cfg.blocksize);
+            w.set_memory_limit(cfg.memory_limit * 1024 * 1024);
+            w.set_pipeline_depth(cfg.pipeline_depth);
+            w.set_io_threads(cfg.io_threads);
+            w.set_io_uring(!cfg.disable_io_uring);
+            w.set_incremental(cfg.incremental);
+            w.set_verify(cfg.verify);
+            w.set_compression(cfg.compress);
+
+            if(cfg.journal_dir) {
+                w.set_journal_dir(*cfg.journal_dir);
+            }
+
+            w.set_mpio_hints(cfg.mpio_hints);
+            w.set_status_tree_arity(cfg.status_tree_arity);
 
             return w.run();
         }
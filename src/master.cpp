@@ -22,7 +22,10 @@
  * SPDX-License-Identifier: GPL-3.0-or-later
  *****************************************************************************/
 
+#include <algorithm>
+#include <fstream>
 #include <functional>
+#include <map>
 #include <logger/logger.hpp>
 #include <net/server.hpp>
 
@@ -37,6 +40,7 @@
 #include "proto/rpc/response.hpp"
 #include "proto/mpi/message.hpp"
 #include "parallel_request.hpp"
+#include <posix_file/journal.hpp>
 
 using namespace std::literals;
 namespace mpi = boost::mpi;
@@ -45,7 +49,9 @@ namespace {
 
 std::tuple<int, cargo::transfer_message>
 make_message(std::uint64_t tid, std::uint32_t seqno,
-             const cargo::dataset& input, const cargo::dataset& output) {
+             const cargo::dataset& input, const cargo::dataset& output,
+             std::uint64_t block_size, std::uint64_t chunk_blocks,
+             const cargo::mpio_hints& hints) {
 
     if(input.supports_parallel_transfer()) {
         return std::make_tuple(
@@ -53,7 +59,8 @@ make_message(std::uint64_t tid, std::uint32_t seqno,
                 cargo::transfer_message{
                         tid, seqno, input.path(),
                         static_cast<uint32_t>(input.get_type()), output.path(),
-                        static_cast<uint32_t>(output.get_type())});
+                        static_cast<uint32_t>(output.get_type()), block_size,
+                        0, hints});
     }
 
     if(output.supports_parallel_transfer()) {
@@ -62,7 +69,8 @@ make_message(std::uint64_t tid, std::uint32_t seqno,
                 cargo::transfer_message{
                         tid, seqno, input.path(),
                         static_cast<uint32_t>(input.get_type()), output.path(),
-                        static_cast<uint32_t>(output.get_type())});
+                        static_cast<uint32_t>(output.get_type()), block_size,
+                        0, hints});
     }
 
     return std::make_tuple(
@@ -70,9 +78,56 @@ make_message(std::uint64_t tid, std::uint32_t seqno,
             cargo::transfer_message{tid, seqno, input.path(),
                                     static_cast<uint32_t>(input.get_type()),
                                     output.path(),
-                                    static_cast<uint32_t>(output.get_type())});
+                                    static_cast<uint32_t>(output.get_type()),
+                                    block_size, chunk_blocks});
 }
 
+// Limits of a batch of small files: large enough to amortize the cost of
+// setting up a transfer, but small enough to spread the files over workers
+constexpr std::size_t max_batch_files = 256;
+constexpr std::uint64_t max_batch_bytes = 64 * 1024 * 1024;
+
+// The cost of setting up the transfer of a file, in bytes transferred, when
+// whole files are balanced among workers
+constexpr std::uint64_t file_overhead_bytes = 1024 * 1024;
+
+// The size of dataset `d` in bytes, if it can be found
+std::optional<std::uint64_t>
+file_size(const cargo::dataset& d) {
+    auto fs = cargo::FSPlugin::make_fs(
+            static_cast<cargo::FSPlugin::type>(d.get_type()));
+    struct stat buf {};
+    if(!fs || fs->stat(d.path(), &buf) != 0) {
+        return std::nullopt;
+    }
+    return static_cast<std::uint64_t>(buf.st_size);
+}
+
+// The preferred I/O size (in KiB) of the files created in directory `dir` of
+// a file system of type `t`, which parallel file systems report as their
+// stripe size, or 0 if it is unknown. New files get the layout of their
+// directory
+std::uint64_t
+stripe_size(cargo::dataset::type t, const std::filesystem::path& dir) {
+    auto fs = cargo::FSPlugin::make_fs(static_cast<cargo::FSPlugin::type>(t));
+    struct stat buf {};
+    if(!fs || fs->stat(dir.empty() ? "." : dir.string(), &buf) != 0) {
+        return 0;
+    }
+    if(buf.st_blksize <= 0 || buf.st_blksize % 1024 != 0) {
+        return 0;
+    }
+    return static_cast<std::uint64_t>(buf.st_blksize) / 1024;
+}
+
+// Number of polls that the MPI listener makes, yielding in between, after
+// handling a message and before it starts to sleep
+constexpr std::size_t listener_spin_polls = 1024;
+
+// Bounds of the time that the MPI listener sleeps between polls while idle
+constexpr double min_listener_sleep_ms = 0.01;
+constexpr double max_listener_sleep_ms = 1.0;
+
 } // namespace
 
 using namespace std::literals;
@@ -85,7 +140,7 @@ master_server::master_server(std::string name, std::string address,
                              std::optional<std::filesystem::path> pidfile)
     : server(std::move(name), std::move(address), daemonize, std::move(rundir),
              std::move(block_size), std::move(pidfile)),
-      provider(m_network_engine, 0),
+      provider(m_network_engine, 0), m_block_size_tuner(block_size),
       m_mpi_listener_ess(thallium::xstream::create()),
       m_mpi_listener_ult(m_mpi_listener_ess->make_thread(
               [this]() { mpi_listener_ult(); })),
@@ -101,6 +156,7 @@ master_server::master_server(std::string name, std::string address,
     provider::define(EXPAND(transfer_datasets));
     provider::define(EXPAND(transfer_status));
     provider::define(EXPAND(bw_control));
+    provider::define(EXPAND(bw_limit));
     provider::define(EXPAND(transfer_statuses));
     provider::define(EXPAND(ftio_int));
 
@@ -125,38 +181,212 @@ master_server::master_server(std::string name, std::string address,
 
 master_server::~master_server() {}
 
+void
+master_server::set_block_size_autotuning(bool enable) {
+    m_block_size_tuner.enable(enable);
+}
+
+void
+master_server::set_small_file_threshold(std::uint64_t bytes) {
+    m_small_file_threshold = bytes;
+}
+
+void
+master_server::set_stripe_threshold(std::uint64_t bytes) {
+    m_stripe_threshold = bytes;
+}
+
+void
+master_server::set_work_stealing(bool enable) {
+    m_block_dispenser.enable(enable);
+}
+
+void
+master_server::set_checksum_manifest(std::filesystem::path path) {
+    m_checksum_manifest = std::move(path);
+}
+
+void
+master_server::record_checksum(std::uint64_t tid, std::uint32_t seqno,
+                               const std::string& name) {
+
+    if(m_checksum_manifest.empty()) {
+        return;
+    }
+
+    const auto crc = m_request_manager.checksum(tid, seqno);
+
+    if(!crc) {
+        return;
+    }
+
+    std::ofstream manifest{m_checksum_manifest, std::ios::app};
+    manifest << fmt::format("{:08x}  {}\n", *crc, name);
+
+    if(!manifest) {
+        LOGGER_ERROR("Failed to write checksum manifest {}",
+                     m_checksum_manifest.string());
+    }
+}
+
+void
+master_server::set_journal_dir(std::filesystem::path dir) {
+    m_journal_dir = std::move(dir);
+}
+
+void
+master_server::remove_journals(std::uint64_t tid, std::uint32_t seqno,
+                               const std::string& name) {
+
+    if(m_journal_dir.empty() || !m_request_manager.completed(tid, seqno)) {
+        return;
+    }
+
+    posix_file::completion_journal::remove(m_journal_dir, name);
+}
+
+void
+master_server::update_status(std::size_t wid, const status_message& m) {
+
+    // updates reduced by a tree of workers summarize all the parts of the
+    // file, so they apply to all of them, with their mean bandwidth
+    const auto bw = m.bw() / static_cast<float>(m.parts());
+
+    if(m.parts() > 1) {
+        m_request_manager.update(m.tid(), m.seqno(), m.name(), m.state(), bw,
+                                 m.error_code(), m.checksum());
+    } else {
+        m_request_manager.update(m.tid(), m.seqno(), wid, m.name(),
+                                 m.state(), bw, m.error_code(), m.checksum());
+    }
+
+    if(m.state() == transfer_state::completed) {
+        record_checksum(m.tid(), m.seqno(), m.name());
+        remove_journals(m.tid(), m.seqno(), m.name());
+    }
+
+    // the blocks of a file are not handed out any more once it has
+    // completed, or once any of its parts has failed
+    if(m.state() == transfer_state::failed ||
+       (m.state() == transfer_state::completed &&
+        m_request_manager.completed(m.tid(), m.seqno()))) {
+        m_block_dispenser.remove(m.tid(), m.seqno());
+    }
+
+    // feed the block size tuner with the bandwidth observed by the workers
+    if(m.state() == transfer_state::running) {
+        m_block_size_tuner.observe(m.tid(), m.seqno(), bw);
+    } else if(m.state() == transfer_state::completed ||
+              m.state() == transfer_state::failed) {
+        m_block_size_tuner.finish(m.tid(), m.seqno());
+    }
+}
+
+void
+master_server::handle_message(mpi::communicator& world,
+                              const mpi::status& msg) {
+
+    switch(static_cast<cargo::tag>(msg.tag())) {
+        case tag::status: {
+            status_message m;
+            world.recv(msg.source(), msg.tag(), m);
+            LOGGER_DEBUG("msg => from: {} body: {{payload: {}}}",
+                         msg.source(), m);
+            update_status(msg.source() - 1, m);
+            break;
+        }
+
+        case tag::status_report: {
+            status_report_message m;
+            world.recv(msg.source(), msg.tag(), m);
+            LOGGER_DEBUG("msg => from: {} body: {{payload: {}}}",
+                         msg.source(), m);
+
+            for(const auto& u : m.updates()) {
+                update_status(msg.source() - 1, u);
+            }
+            break;
+        }
+
+        case tag::batch_status: {
+            batch_status_message m;
+            world.recv(msg.source(), msg.tag(), m);
+            LOGGER_DEBUG("msg => from: {} body: {{payload: {}}}",
+                         msg.source(), m);
+
+            for(std::size_t i = 0; i < m.size(); ++i) {
+                m_request_manager.update(m.tid(), m.seqnos()[i],
+                                         m.names()[i], m.state(), m.bw(),
+                                         m.error_code(), m.checksums()[i]);
+
+                if(m.state() == transfer_state::completed) {
+                    record_checksum(m.tid(), m.seqnos()[i], m.names()[i]);
+                }
+            }
+            break;
+        }
+
+        case tag::claim: {
+            claim_message m;
+            world.recv(msg.source(), msg.tag(), m);
+            LOGGER_DEBUG("msg => from: {} body: {{payload: {}}}",
+                         msg.source(), m);
+
+            const auto [first, count] =
+                    m_block_dispenser.claim(m.tid(), m.seqno());
+            const grant_message g{m.tid(), m.seqno(), first, count};
+
+            LOGGER_DEBUG("msg <= to: {} body: {{payload: {}}}",
+                         msg.source(), g);
+            world.send(msg.source(), static_cast<int>(tag::grant), g);
+            break;
+        }
+
+        default:
+            LOGGER_WARN("msg => from: {} body: {{Unexpected tag: {}}}",
+                        msg.source(), msg.tag());
+            break;
+    }
+}
+
 void
 master_server::mpi_listener_ult() {
 
     mpi::communicator world;
+
+    // consecutive polls that found no message, and how long the listener
+    // sleeps before the next one once it is idle
+    std::size_t idle_polls = 0;
+    double sleep_ms = min_listener_sleep_ms;
+
     while(!m_shutting_down) {
 
-        auto msg = world.iprobe();
+        // handle every message already pending, so that a burst of status
+        // updates is drained in a single wake-up
+        bool received = false;
 
-        if(!msg) {
-            std::this_thread::sleep_for(10ms);
-            // thallium::thread::self().sleep(m_network_engine, 10);
-            continue;
+        while(const auto msg = world.iprobe()) {
+            handle_message(world, *msg);
+            received = true;
         }
 
-        switch(static_cast<cargo::tag>(msg->tag())) {
-            case tag::status: {
-                status_message m;
-                world.recv(msg->source(), msg->tag(), m);
-                LOGGER_DEBUG("msg => from: {} body: {{payload: {}}}",
-                             msg->source(), m);
-
-                m_request_manager.update(m.tid(), m.seqno(), msg->source() - 1,
-                                         m.name(), m.state(), m.bw(),
-                                         m.error_code());
-                break;
-            }
+        if(received) {
+            idle_polls = 0;
+            sleep_ms = min_listener_sleep_ms;
+        }
 
-            default:
-                LOGGER_WARN("msg => from: {} body: {{Unexpected tag: {}}}",
-                            msg->source(), msg->tag());
-                break;
+        // right after a message, only yield to other ULTs between polls,
+        // since more are likely to follow. Once idle, sleep in the Argobots
+        // scheduler rather than blocking the whole execution stream, backing
+        // off exponentially
+        if(idle_polls < listener_spin_polls) {
+            ++idle_polls;
+            thallium::thread::yield();
+            continue;
         }
+
+        thallium::thread::sleep(m_network_engine, sleep_ms);
+        sleep_ms = std::min(2 * sleep_ms, max_listener_sleep_ms);
     }
 
     LOGGER_INFO("Shutting down. Notifying workers...");
@@ -306,6 +536,50 @@ master_server::bw_control(const network::request& req, std::uint64_t tid,
     req.respond(resp);
 }
 
+void
+master_server::bw_limit(const network::request& req, std::uint64_t tid,
+                        std::uint64_t bytes_per_second) {
+    using network::get_address;
+    using network::rpc_info;
+    using proto::generic_response;
+    mpi::communicator world;
+    const auto rpc = rpc_info::create(RPC_NAME(), get_address(req));
+
+    LOGGER_INFO("rpc {:>} body: {{tid: {}, bytes_per_second: {}}}", rpc, tid,
+                bytes_per_second);
+
+    // the limit applies to the whole transfer, so it is split evenly among
+    // the workers that hold parts of it, or among all of them if it has not
+    // been dispatched yet (making sure that a limit is never turned into no
+    // limit)
+    auto workers = m_request_manager.workers(tid);
+
+    if(workers.empty()) {
+        for(int rank = 1; rank < world.size(); ++rank) {
+            workers.insert(static_cast<std::size_t>(rank - 1));
+        }
+    }
+
+    const auto worker_limit =
+            bytes_per_second == 0
+                    ? 0
+                    : std::max<std::uint64_t>(
+                              bytes_per_second / workers.size(), 1);
+
+    for(const auto wid : workers) {
+        const auto rank = static_cast<int>(wid + 1);
+        const auto m = cargo::bw_limit_message{tid, worker_limit};
+        LOGGER_INFO("msg <= to: {} body: {}", rank, m);
+        world.send(rank, static_cast<int>(tag::bw_limit), m);
+    }
+
+    const auto resp = generic_response{rpc.id(), error_code::success};
+
+    LOGGER_INFO("rpc {:<} body: {{retval: {}}}", rpc, resp.error_code());
+
+    req.respond(resp);
+}
+
 void
 master_server::shutdown(const network::request& req) {
     using network::get_address;
@@ -324,7 +598,6 @@ master_server::shutdown(const network::request& req) {
 void
 master_server::transfer_dataset_internal(pending_transfer& pt) {
 
-    mpi::communicator world;
     std::vector<cargo::dataset> v_s_new;
     std::vector<cargo::dataset> v_d_new;
     time_t now = time(0);
@@ -409,10 +682,122 @@ master_server::transfer_dataset_internal(pending_transfer& pt) {
 
     assert(v_s_new.size() == v_d_new.size());
 
+    dispatch(pt.m_p, v_s_new, v_d_new, pt.m_hints);
+}
+
+void
+master_server::dispatch(const parallel_request& r,
+                        const std::vector<dataset>& sources,
+                        const std::vector<dataset>& targets,
+                        const cargo::mpio_hints& hints) {
+
+    mpi::communicator world;
+    std::optional<batch_message> batch;
+    std::pair<dataset::type, dataset::type> batch_types;
+    std::uint64_t batch_bytes = 0;
+    // the worker that receives the current batch (0 for any of them)
+    int batch_rank = 0;
+
+    // batches of small files are spread over the workers in round-robin
+    // order
+    const auto send_batch = [&]() {
+        if(!batch) {
+            return;
+        }
+        const auto rank =
+                batch_rank != 0
+                        ? batch_rank
+                        : static_cast<int>(1 + m_next_batch_worker++ %
+                                                       r.nworkers());
+        LOGGER_INFO("msg <= to: {} body: {}", rank, *batch);
+        m_request_manager.add_worker(r.tid(), rank - 1);
+        world.send(rank, static_cast<int>(tag::batch), *batch);
+        batch.reset();
+        batch_bytes = 0;
+    };
+
+    // add file `i` to the batch for worker `rank` (0 for any of them). The
+    // file is transferred whole by that worker, so it has a single part
+    const auto add_to_batch = [&](std::size_t i, std::uint64_t size,
+                                  int rank) {
+        const auto& s = sources[i];
+        const auto& d = targets[i];
+
+        // all the files in a batch share their storage types
+        const auto types = std::make_pair(s.get_type(), d.get_type());
+
+        if(batch && (types != batch_types || rank != batch_rank)) {
+            send_batch();
+        }
+
+        if(!batch) {
+            batch.emplace(r.tid(), static_cast<std::uint32_t>(types.first),
+                          static_cast<std::uint32_t>(types.second));
+            batch_types = types;
+            batch_rank = rank;
+        }
+
+        m_request_manager.set_workers(r.tid(), i, 1);
+        batch->add(i, s.path(), d.path());
+        batch_bytes += size;
+
+        if(batch->size() >= max_batch_files ||
+           batch_bytes >= max_batch_bytes) {
+            send_batch();
+        }
+    };
+
+    // files split among all the workers. The list is serialized once and
+    // sent to all of them concurrently, rather than sending each file to
+    // each worker in turn
+    transfer_list_message transfers;
+
+    const auto send_transfers = [&]() {
+        if(transfers.size() == 0) {
+            return;
+        }
+
+        mpi::packed_oarchive archive{world};
+        archive << transfers;
+
+        std::vector<mpi::request> requests;
+        requests.reserve(r.nworkers());
+
+        for(std::size_t rank = 1; rank <= r.nworkers(); ++rank) {
+            LOGGER_INFO("msg <= to: {} body: {}", rank, transfers);
+            m_request_manager.add_worker(r.tid(), rank - 1);
+            requests.push_back(world.isend(static_cast<int>(rank),
+                                           static_cast<int>(tag::transfer_list),
+                                           archive));
+        }
+
+        mpi::wait_all(requests.begin(), requests.end());
+    };
+
+    // the files of a directory share its layout, so the stripe size is
+    // queried once per output directory rather than once per file
+    std::map<std::pair<dataset::type, std::filesystem::path>, std::uint64_t>
+            stripe_sizes;
+
+    const auto output_stripe_size = [&](const dataset& d) {
+        const auto dir = std::filesystem::path{d.path()}.parent_path();
+        const auto [it, inserted] =
+                stripe_sizes.try_emplace({d.get_type(), dir}, 0);
+
+        if(inserted) {
+            it->second = stripe_size(d.get_type(), dir);
+        }
+
+        return it->second;
+    };
+
+    // files assigned whole to a worker, with their sizes
+    std::vector<std::pair<std::uint64_t, std::size_t>> whole_files;
+
     // For all the transfers
-    for(std::size_t i = 0; i < v_s_new.size(); ++i) {
-        const auto& s = v_s_new[i];
-        const auto& d = v_d_new[i];
+    for(std::size_t i = 0; i < sources.size(); ++i) {
+        const auto& s = sources[i];
+        const auto& d = targets[i];
 
         // Create the directory if it does not exist (only in
         // parallel transfer)
@@ -422,20 +807,95 @@ master_server::transfer_dataset_internal(pending_transfer& pt) {
                     std::filesystem::path(d.path()).parent_path());
         }
 
+        const auto size = file_size(s);
+        const bool sequential = size && !s.supports_parallel_transfer() &&
+                                !d.supports_parallel_transfer();
 
-        // Send message to worker
-        for(std::size_t rank = 1; rank <= pt.m_p.nworkers(); ++rank) {
-            const auto [t, m] = make_message(pt.m_p.tid(), i, s, d);
-            LOGGER_INFO("msg <= to: {} body: {}", rank, m);
-            world.send(static_cast<int>(rank), t, m);
+        // files up to the stripe threshold are not split among workers:
+        // they are assigned whole to a worker once all sizes are known
+        if(sequential && m_stripe_threshold != 0 &&
+           *size <= m_stripe_threshold) {
+            whole_files.emplace_back(*size, i);
+            continue;
+        }
+
+        // small files are not worth splitting among workers: add them to
+        // the current batch instead
+        if(sequential && m_small_file_threshold != 0 &&
+           *size <= m_small_file_threshold) {
+            add_to_batch(i, *size, 0);
+            continue;
+        }
+
+        const auto block_size =
+                m_block_size_tuner.assign(r.tid(), i, s.get_type(),
+                                          d.get_type(), size, r.nworkers(),
+                                          output_stripe_size(d));
+
+        // the blocks of sequential transfers are handed out on demand, so
+        // that faster workers take over the blocks of slower ones
+        std::uint64_t chunk_blocks = 0;
+
+        if(sequential && block_size != 0) {
+            const std::uint64_t bytes_per_block = block_size * 1024;
+            chunk_blocks = m_block_dispenser.add(
+                    r.tid(), i,
+                    (*size + bytes_per_block - 1) / bytes_per_block,
+                    r.nworkers());
+        }
+
+        // all the workers get the same message for the file, so it is added
+        // to the list sent to all of them at the end
+        const auto [t, m] = make_message(r.tid(), i, s, d, block_size,
+                                         chunk_blocks, hints);
+        LOGGER_INFO("msg <= to: all body: {}", m);
+        transfers.add(static_cast<cargo::tag>(t), m);
+    }
+
+    send_batch();
+    send_transfers();
+
+    if(whole_files.empty()) {
+        return;
+    }
+
+    // Assign the largest files first, each to the least loaded worker
+    // (LPT scheduling). Every file also costs a fixed amount, so that
+    // empty files are spread over the workers too
+    std::ranges::sort(whole_files, std::greater{});
+
+    std::vector<std::uint64_t> load(r.nworkers());
+    std::vector<decltype(whole_files)> files(r.nworkers());
+
+    for(const auto& f : whole_files) {
+        const auto w = static_cast<std::size_t>(
+                std::ranges::min_element(load) - load.begin());
+        load[w] += f.first + file_overhead_bytes;
+        files[w].push_back(f);
+    }
+
+    for(std::size_t w = 0; w < files.size(); ++w) {
+
+        // keep files of the same storage types together, so that they
+        // share batches
+        std::ranges::stable_sort(files[w], std::less{}, [&](const auto& f) {
+            return std::make_pair(sources[f.second].get_type(),
+                                  targets[f.second].get_type());
+        });
+
+        for(const auto& [size, i] : files[w]) {
+            add_to_batch(i, size, static_cast<int>(w + 1));
         }
     }
+
+    send_batch();
 }
 
 void
 master_server::transfer_datasets(const network::request& req,
                                  const std::vector<dataset>& sources,
-                                 const std::vector<dataset>& targets) {
+                                 const std::vector<dataset>& targets,
+                                 const cargo::mpio_hints& hints) {
     using network::get_address;
     using network::rpc_info;
     using proto::generic_response;
@@ -444,8 +904,8 @@ master_server::transfer_datasets(const network::request& req,
     mpi::communicator world;
     const auto rpc = rpc_info::create(RPC_NAME(), get_address(req));
 
-    LOGGER_INFO("rpc {:>} body: {{sources: {}, targets: {}}}", rpc, sources,
-                targets);
+    LOGGER_INFO("rpc {:>} body: {{sources: {}, targets: {}, hints: {}}}", rpc,
+                sources, targets, hints);
 
 
     // As we accept directories expanding directories should be done before
@@ -531,40 +991,17 @@ master_server::transfer_datasets(const network::request& req,
                         m_pending_transfer.m_p = r;
                         m_pending_transfer.m_sources = sources;
                         m_pending_transfer.m_targets = targets;
+                        m_pending_transfer.m_hints = hints;
                         m_pending_transfer.m_work = true;
                         LOGGER_INFO("Stored stage-out information");
                     }
                 }
-                // For all the transfers
-                for(std::size_t i = 0; i < v_s_new.size(); ++i) {
-                    const auto& s = v_s_new[i];
-                    const auto& d = v_d_new[i];
-
-                    // Create the directory if it does not exist (only in
-                    // parallel transfer)
-                    if(!std::filesystem::path(d.path())
-                                .parent_path()
-                                .empty() and
-                       d.supports_parallel_transfer()) {
-                        std::filesystem::create_directories(
-                                std::filesystem::path(d.path()).parent_path());
-                    }
-
-                    // If we are not using ftio start transfer if we are on
-                    // stage-out
-                    if(!m_ftio) {
-                        // If we are on stage-out
-
-
-                        for(std::size_t rank = 1; rank <= r.nworkers();
-                            ++rank) {
-                            const auto [t, m] = make_message(r.tid(), i, s, d);
-                            LOGGER_INFO("msg <= to: {} body: {}", rank, m);
-                            world.send(static_cast<int>(rank), t, m);
-                        }
-                    } else {
-                        m_ftio_tid = r.tid();
-                    }
+                // If we are not using ftio start transfer if we are on
+                // stage-out
+                if(!m_ftio) {
+                    dispatch(r, v_s_new, v_d_new, hints);
+                } else if(!v_s_new.empty()) {
+                    m_ftio_tid = r.tid();
                 }
                 LOGGER_INFO("rpc {:<} body: {{retval: {}, tid: {}}}", rpc,
                             error_code::success, r.tid());
@@ -635,11 +1072,12 @@ master_server::transfer_statuses(const network::request& req,
                 // convert them to a vector of tuples with the same
                 // informations
                 std::vector<std::tuple<std::string, cargo::transfer_state,
-                                       float, std::optional<cargo::error_code>>>
+                                       float, std::optional<cargo::error_code>,
+                                       std::optional<std::uint32_t>>>
                         v{};
                 for(auto& r : rs) {
                     v.push_back(std::make_tuple(r.name(), r.state(), r.bw(),
-                                                r.error()));
+                                                r.error(), r.checksum()));
                     LOGGER_INFO(
                             "rpc {:<} body: {{retval: {}, name: {}, status: {}}}",
                             rpc, error_code::success, r.name(), r.state());
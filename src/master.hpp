@@ -25,10 +25,16 @@
 #ifndef CARGO_MASTER_HPP
 #define CARGO_MASTER_HPP
 
+#include <atomic>
+#include <boost/mpi/communicator.hpp>
+#include <boost/mpi/status.hpp>
 #include "net/server.hpp"
 #include "cargo.hpp"
 #include "request_manager.hpp"
+#include "block_size_tuner.hpp"
+#include "block_dispenser.hpp"
 #include "parallel_request.hpp"
+#include "proto/mpi/message.hpp"
 
 namespace cargo {
 
@@ -42,6 +48,7 @@ public:
     cargo::parallel_request m_p;
     std::vector<cargo::dataset> m_sources;
     std::vector<cargo::dataset> m_targets;
+    cargo::mpio_hints m_hints;
     // Expanded sources and targets (those that are being processed by the worker)
     std::vector<cargo::dataset> m_expanded_sources;
     std::vector<cargo::dataset> m_expanded_targets;
@@ -56,10 +63,50 @@ public:
 
     ~master_server();
 
+    // Let the master adapt the block size of each file transfer to the
+    // bandwidth observed by the workers
+    void
+    set_block_size_autotuning(bool enable);
+
+    // Files up to `bytes` long are sent to the workers in batches, each of
+    // them transferred by a single worker (0 disables batching)
+    void
+    set_small_file_threshold(std::uint64_t bytes);
+
+    // Files up to `bytes` long are assigned whole to a single worker,
+    // balancing the bytes sent to each worker, while larger files are
+    // split among all of them (0 splits all files)
+    void
+    set_stripe_threshold(std::uint64_t bytes);
+
+    // Let the workers claim the blocks of sequential transfers on demand
+    // instead of splitting them evenly beforehand
+    void
+    set_work_stealing(bool enable);
+
+    // Append the CRC32C digest and the name of each verified file to `path`
+    // as soon as all its workers have completed
+    void
+    set_checksum_manifest(std::filesystem::path path);
+
+    // Remove the completion journals kept by the workers in `dir` for each
+    // file as soon as all its workers have completed
+    void
+    set_journal_dir(std::filesystem::path dir);
+
 private:
     void
     mpi_listener_ult();
 
+    // Apply update `m` sent by worker `wid` to the state of its transfer
+    void
+    update_status(std::size_t wid, const status_message& m);
+
+    // Receive the message from the workers described by `msg` and act on it
+    void
+    handle_message(boost::mpi::communicator& world,
+                   const boost::mpi::status& msg);
+
     void
     ftio_scheduling_ult();
 
@@ -72,7 +119,8 @@ private:
     void
     transfer_datasets(const network::request& req,
                       const std::vector<cargo::dataset>& sources,
-                      const std::vector<cargo::dataset>& targets);
+                      const std::vector<cargo::dataset>& targets,
+                      const cargo::mpio_hints& hints);
 
     void
     transfer_status(const network::request& req, std::uint64_t tid);
@@ -86,12 +134,21 @@ private:
     bw_control(const network::request& req, std::uint64_t tid,
                std::int16_t shaping);
 
+    void
+    bw_limit(const network::request& req, std::uint64_t tid,
+             std::uint64_t bytes_per_second);
+
 
     void
     ftio_int(const network::request& req, float confidence, float probability,
              float period, bool run, bool pause, bool resume);
 
 private:
+    // Chooses the block size of each file. Declared before the ULTs that use
+    // it so that it is constructed first
+    block_size_tuner m_block_size_tuner;
+    // Hands out the blocks of sequential transfers to the workers
+    block_dispenser m_block_dispenser;
     // Dedicated execution stream for the MPI listener ULT
     thallium::managed<thallium::xstream> m_mpi_listener_ess;
     // ULT for the MPI listener
@@ -116,6 +173,34 @@ private:
 
     void
     transfer_dataset_internal(pending_transfer& pt);
+
+    // Record the digest of file `seqno` of transfer `tid` in the checksum
+    // manifest, if all its parts have been verified
+    void
+    record_checksum(std::uint64_t tid, std::uint32_t seqno,
+                    const std::string& name);
+
+    // Remove the completion journals of output file `name`, file `seqno` of
+    // transfer `tid`, once all its workers have completed
+    void
+    remove_journals(std::uint64_t tid, std::uint32_t seqno,
+                    const std::string& name);
+
+    // Send the transfers of request `r` to the workers, along with the
+    // MPI-IO `hints` for those transferred collectively. Small files, and
+    // files below the stripe threshold, are grouped in batches, each sent
+    // to a single worker
+    void
+    dispatch(const parallel_request& r, const std::vector<dataset>& sources,
+             const std::vector<dataset>& targets,
+             const cargo::mpio_hints& hints);
+
+    std::uint64_t m_small_file_threshold = 0;
+    std::uint64_t m_stripe_threshold = 0;
+    std::filesystem::path m_checksum_manifest;
+    std::filesystem::path m_journal_dir;
+    // Worker that receives the next batch of small files
+    std::atomic<std::size_t> m_next_batch_worker = 0;
     // Request manager
     request_manager m_request_manager;
 };
@@ -29,6 +29,9 @@
 #include <boost/mpi.hpp>
 #include <boost/mpi/error_string.hpp>
 #include <filesystem>
+#include <string>
+#include <utility>
+#include <vector>
 #include <fmt/format.h>
 #include <fmt/chrono.h>
 #include <logger/logger.hpp>
@@ -114,11 +117,149 @@ operator^=(file_open_mode& a, file_open_mode b) {
     return a = a ^ b;
 }
 
+// A committed MPI datatype, freed on destruction
+class datatype {
+
+public:
+    datatype() = default;
+
+    // Commit `type` and take ownership of it
+    explicit datatype(MPI_Datatype type) : m_type(type) {
+        if(const auto ec = MPI_Type_commit(&m_type); ec != MPI_SUCCESS) {
+            MPI_Type_free(&m_type);
+            throw io_error("MPI_Type_commit", ec);
+        }
+    }
+
+    // A contiguous block of `count` elements of type `oldtype`
+    static datatype
+    contiguous(int count, MPI_Datatype oldtype) {
+        MPI_Datatype result;
+        if(const auto ec = MPI_Type_contiguous(count, oldtype, &result);
+           ec != MPI_SUCCESS) {
+            throw io_error("MPI_Type_contiguous", ec);
+        }
+        return datatype{result};
+    }
+
+    // `count` blocks of `blocklength` elements of type `oldtype`, starting
+    // `stride` elements apart
+    static datatype
+    vector(int count, int blocklength, int stride, MPI_Datatype oldtype) {
+        MPI_Datatype result;
+        if(const auto ec = MPI_Type_vector(count, blocklength, stride,
+                                           oldtype, &result);
+           ec != MPI_SUCCESS) {
+            throw io_error("MPI_Type_vector", ec);
+        }
+        return datatype{result};
+    }
+
+    datatype(datatype&& rhs) noexcept : m_type(rhs.m_type) {
+        rhs.m_type = MPI_DATATYPE_NULL;
+    }
+
+    datatype(const datatype& other) = delete;
+
+    datatype&
+    operator=(datatype&& rhs) noexcept {
+        std::swap(m_type, rhs.m_type);
+        return *this;
+    }
+
+    datatype&
+    operator=(const datatype& other) = delete;
+
+    ~datatype() {
+        if(m_type != MPI_DATATYPE_NULL) {
+            MPI_Type_free(&m_type);
+        }
+    }
+
+    operator MPI_Datatype() const { // NOLINT
+        return m_type;
+    }
+
+private:
+    MPI_Datatype m_type = MPI_DATATYPE_NULL;
+};
+
+// A set of hints for MPI-IO, or MPI_INFO_NULL if it is empty
+class info {
+
+public:
+    info() = default;
+
+    explicit info(
+            const std::vector<std::pair<std::string, std::string>>& hints) {
+
+        if(hints.empty()) {
+            return;
+        }
+
+        if(const auto ec = MPI_Info_create(&m_info); ec != MPI_SUCCESS) {
+            throw io_error("MPI_Info_create", ec);
+        }
+
+        for(const auto& [key, value] : hints) {
+            if(const auto ec =
+                       MPI_Info_set(m_info, key.c_str(), value.c_str());
+               ec != MPI_SUCCESS) {
+                MPI_Info_free(&m_info);
+                throw io_error("MPI_Info_set", ec);
+            }
+        }
+    }
+
+    info(info&& rhs) noexcept : m_info(rhs.m_info) {
+        rhs.m_info = MPI_INFO_NULL;
+    }
+
+    info(const info& other) = delete;
+
+    info&
+    operator=(info&& rhs) noexcept {
+        std::swap(m_info, rhs.m_info);
+        return *this;
+    }
+
+    info&
+    operator=(const info& other) = delete;
+
+    ~info() {
+        if(m_info != MPI_INFO_NULL) {
+            MPI_Info_free(&m_info);
+        }
+    }
+
+    operator MPI_Info() const { // NOLINT
+        return m_info;
+    }
+
+private:
+    MPI_Info m_info = MPI_INFO_NULL;
+};
+
 class file {
 
 public:
     explicit file(const MPI_File& file) : m_file(file) {}
 
+    file(file&& rhs) noexcept : m_file(rhs.m_file) {
+        rhs.m_file = MPI_FILE_NULL;
+    }
+
+    file(const file& other) = delete;
+
+    file&
+    operator=(file&& rhs) noexcept {
+        std::swap(m_file, rhs.m_file);
+        return *this;
+    }
+
+    file&
+    operator=(const file& other) = delete;
+
     ~file() {
         if(m_file != MPI_FILE_NULL) {
             close();
@@ -131,14 +272,14 @@ public:
 
     static file
     open(const boost::mpi::communicator& comm,
-         const std::filesystem::path& filepath, file_open_mode mode) {
+         const std::filesystem::path& filepath, file_open_mode mode,
+         MPI_Info hints = MPI_INFO_NULL) {
 
         MPI_File result;
 
-    
         if(const auto ec =
                    MPI_File_open(comm, filepath.c_str(), static_cast<int>(mode),
-                                 MPI_INFO_NULL, &result);
+                                 hints, &result);
            ec != MPI_SUCCESS) {
             throw io_error("MPI_File_open", ec);
         }
@@ -79,6 +79,16 @@ request_status::bw(float bw) {
     m_bw = bw;
 }
 
+std::optional<std::uint32_t>
+request_status::checksum() const {
+    return m_checksum;
+}
+
+void
+request_status::checksum(std::optional<std::uint32_t> checksum) {
+    m_checksum = checksum;
+}
+
 std::string
 part_status::name() const {
     return m_name;
@@ -99,13 +109,20 @@ part_status::error() const {
     return m_error_code;
 }
 
+std::optional<std::uint32_t>
+part_status::checksum() const {
+    return m_checksum;
+}
+
 void
 part_status::update(std::string name, transfer_state s, float bw,
-                    std::optional<error_code> ec) noexcept {
+                    std::optional<error_code> ec,
+                    std::optional<std::uint32_t> checksum) noexcept {
     m_name = name;
     m_state = s;
     m_bw = bw;
     m_error_code = ec;
+    m_checksum = checksum;
 }
 
 } // namespace cargo
\ No newline at end of file
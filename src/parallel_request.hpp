@@ -77,14 +77,21 @@ public:
     [[nodiscard]] float
     bw() const;
 
+    // The digest of the part, if it has completed and it was verified
+    [[nodiscard]] std::optional<std::uint32_t>
+    checksum() const;
+
     void
-    update(std::string name, transfer_state s, float bw, std::optional<error_code> ec) noexcept;
+    update(std::string name, transfer_state s, float bw,
+           std::optional<error_code> ec,
+           std::optional<std::uint32_t> checksum = std::nullopt) noexcept;
 
 private:
     std::string m_name;
     transfer_state m_state{transfer_state::pending};
     float m_bw;
     std::optional<error_code> m_error_code{};
+    std::optional<std::uint32_t> m_checksum{};
 };
 
 class request_status {
@@ -108,12 +115,20 @@ public:
 
     void
     bw (float bw);
+
+    // The CRC32C of the whole file, if it has completed and it was verified
+    [[nodiscard]] std::optional<std::uint32_t>
+    checksum() const;
+
+    void
+    checksum(std::optional<std::uint32_t> checksum);
     
 private:
     std::string m_name;
     transfer_state m_state{transfer_state::pending};
     float m_bw;
     std::optional<error_code> m_error_code{};
+    std::optional<std::uint32_t> m_checksum{};
 };
 
 } // namespace cargo
@@ -0,0 +1,149 @@
+/******************************************************************************
+ * Copyright 2022-2023, Barcelona Supercomputing Center (BSC), Spain
+ *
+ * This software was partially supported by the EuroHPC-funded project ADMIRE
+ *   (Project ID: 956748, https://www.admire-eurohpc.eu).
+ *
+ * This file is part of Cargo.
+ *
+ * Cargo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cargo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cargo.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *****************************************************************************/
+
+
+#ifndef POSIX_FILE_BLOCK_PLAN_HPP
+#define POSIX_FILE_BLOCK_PLAN_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include "types.hpp"
+#include "ranges.hpp"
+
+namespace posix_file {
+
+/**
+ * The precomputed geometry of a strided block decomposition of a file.
+ *
+ * A `block_plan` describes the same sequence of ranges as
+ * `all_of(f) | as_blocks(block_size) | strided(step, skip)`, but the file
+ * size is captured once on construction and the `k`-th range of the sequence
+ * is computed in constant time, so that a transfer can resume from any block
+ * without walking the view (or querying the file size) again.
+ *
+ * For instance, for a file `f` of 2560 bytes, the following plan:
+ *
+ * ```cpp
+ * block_plan p{f.size(), 512, 2, 1};
+ * ```
+ *
+ * contains 2 ranges: `p[0] == {512, 512}` and `p[1] == {1536, 512}`.
+ */
+class block_plan {
+
+public:
+    constexpr block_plan() noexcept = default;
+
+    /**
+     * Construct a plan for a file of `file_size` bytes.
+     *
+     * @param file_size The size of the file in bytes.
+     * @param block_size The block size in bytes.
+     * @param step The number of blocks advanced between two ranges.
+     * @param skip The number of blocks skipped from the beginning of the file.
+     */
+    constexpr block_plan(std::size_t file_size, std::size_t block_size,
+                         std::size_t step = 1, std::size_t skip = 0) noexcept
+        : m_file_size(file_size), m_block_size(block_size), m_step(step),
+          m_skip(skip),
+          m_total_blocks(block_size == 0
+                                 ? 0
+                                 : (file_size + block_size - 1) / block_size),
+          m_size(m_total_blocks <= skip || step == 0
+                         ? 0
+                         : (m_total_blocks - skip + step - 1) / step) {}
+
+    constexpr std::size_t
+    file_size() const noexcept {
+        return m_file_size;
+    }
+
+    constexpr std::size_t
+    block_size() const noexcept {
+        return m_block_size;
+    }
+
+    /**
+     * Return the number of blocks in the whole file.
+     *
+     * @return The number of blocks in the file, including those that do not
+     * belong to this plan.
+     */
+    constexpr std::size_t
+    total_blocks() const noexcept {
+        return m_total_blocks;
+    }
+
+    /**
+     * Return the number of ranges in this plan.
+     *
+     * @return The number of ranges in this plan.
+     */
+    constexpr std::size_t
+    size() const noexcept {
+        return m_size;
+    }
+
+    constexpr bool
+    empty() const noexcept {
+        return m_size == 0;
+    }
+
+    /**
+     * Return the index (in the whole file) of the `k`-th block of this plan.
+     *
+     * @param k The position of the block in this plan.
+     * @return The index of the block in the file.
+     */
+    constexpr std::size_t
+    block_index(std::size_t k) const noexcept {
+        return m_skip + k * m_step;
+    }
+
+    /**
+     * Return the `k`-th range of this plan. The last block of the file may
+     * be shorter than `block_size()`.
+     *
+     * @param k The position of the range in this plan (`k < size()`).
+     * @return The file range for the `k`-th block.
+     */
+    constexpr ranges::range
+    operator[](std::size_t k) const noexcept {
+        const std::size_t offset = block_index(k) * m_block_size;
+        return ranges::range{static_cast<posix_file::offset>(offset),
+                             std::min(m_block_size, m_file_size - offset)};
+    }
+
+private:
+    std::size_t m_file_size = 0;
+    std::size_t m_block_size = 0;
+    std::size_t m_step = 1;
+    std::size_t m_skip = 0;
+    std::size_t m_total_blocks = 0;
+    std::size_t m_size = 0;
+};
+
+} // namespace posix_file
+
+#endif // POSIX_FILE_BLOCK_PLAN_HPP
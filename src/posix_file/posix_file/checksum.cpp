@@ -0,0 +1,221 @@
+/******************************************************************************
+ * Copyright 2022-2023, Barcelona Supercomputing Center (BSC), Spain
+ *
+ * This software was partially supported by the EuroHPC-funded project ADMIRE
+ *   (Project ID: 956748, https://www.admire-eurohpc.eu).
+ *
+ * This file is part of Cargo.
+ *
+ * Cargo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cargo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cargo.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *****************************************************************************/
+
+#include "checksum.hpp"
+
+#include <array>
+#include <bit>
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#endif
+
+namespace {
+
+// CRC32C polynomial, in reversed bit order
+constexpr std::uint32_t polynomial = 0x82f63b78;
+
+// Tables for the software implementation, which processes 8 bytes at once
+constexpr auto tables = [] {
+    std::array<std::array<std::uint32_t, 256>, 8> t{};
+
+    for(std::uint32_t i = 0; i < 256; ++i) {
+        std::uint32_t c = i;
+        for(int k = 0; k < 8; ++k) {
+            c = c & 1 ? (c >> 1) ^ polynomial : c >> 1;
+        }
+        t[0][i] = c;
+    }
+
+    for(std::uint32_t i = 0; i < 256; ++i) {
+        for(std::size_t k = 1; k < t.size(); ++k) {
+            t[k][i] = (t[k - 1][i] >> 8) ^ t[0][t[k - 1][i] & 0xff];
+        }
+    }
+
+    return t;
+}();
+
+// Multiply `a` and `b` modulo the CRC32C polynomial. `a` must not be 0
+constexpr std::uint32_t
+multiply(std::uint32_t a, std::uint32_t b) noexcept {
+
+    std::uint32_t m = 1u << 31;
+    std::uint32_t p = 0;
+
+    for(;;) {
+        if(a & m) {
+            p ^= b;
+            if((a & (m - 1)) == 0) {
+                break;
+            }
+        }
+        m >>= 1;
+        b = b & 1 ? (b >> 1) ^ polynomial : b >> 1;
+    }
+
+    return p;
+}
+
+// x^(2^k) modulo the CRC32C polynomial, for k in [0, 32)
+constexpr auto powers = [] {
+    std::array<std::uint32_t, 32> t{};
+    std::uint32_t p = 1u << 30; // x^1
+
+    t[0] = p;
+    for(std::size_t k = 1; k < t.size(); ++k) {
+        t[k] = p = multiply(p, p);
+    }
+
+    return t;
+}();
+
+// x^(8 * bytes) modulo the CRC32C polynomial
+std::uint32_t
+shift_operator(std::uint64_t bytes) noexcept {
+
+    std::uint32_t p = 1u << 31; // x^0
+    std::size_t k = 3;
+
+    for(; bytes != 0; bytes >>= 1, ++k) {
+        if(bytes & 1) {
+            p = multiply(powers[k % powers.size()], p);
+        }
+    }
+
+    return p;
+}
+
+// The functions below update the CRC state without its pre and post
+// conditioning
+
+std::uint32_t
+update_table(std::uint32_t crc, const unsigned char* p,
+             std::size_t n) noexcept {
+
+    if constexpr(std::endian::native == std::endian::little) {
+        for(; n >= 8; p += 8, n -= 8) {
+            std::uint64_t w;
+            std::memcpy(&w, p, sizeof(w));
+            w ^= crc;
+            crc = tables[7][w & 0xff] ^ tables[6][(w >> 8) & 0xff] ^
+                  tables[5][(w >> 16) & 0xff] ^ tables[4][(w >> 24) & 0xff] ^
+                  tables[3][(w >> 32) & 0xff] ^ tables[2][(w >> 40) & 0xff] ^
+                  tables[1][(w >> 48) & 0xff] ^ tables[0][w >> 56];
+        }
+    }
+
+    for(; n != 0; ++p, --n) {
+        crc = (crc >> 8) ^ tables[0][(crc ^ *p) & 0xff];
+    }
+
+    return crc;
+}
+
+#if defined(__x86_64__)
+
+// Buffers of at least this many bytes are split in three streams
+constexpr std::size_t min_stream_bytes = 3 * 1024;
+
+__attribute__((target("sse4.2"))) std::uint32_t
+update_sse42(std::uint32_t crc, const unsigned char* p,
+             std::size_t n) noexcept {
+
+    const auto load = [](const unsigned char* q) {
+        std::uint64_t w;
+        std::memcpy(&w, q, sizeof(w));
+        return w;
+    };
+
+    if(n >= min_stream_bytes) {
+        // each stream starts from a zero state and is then shifted over the
+        // streams that follow it
+        const std::size_t len = n / 3 & ~std::size_t{7};
+        std::uint64_t a = crc;
+        std::uint64_t b = 0;
+        std::uint64_t c = 0;
+
+        for(std::size_t i = 0; i < len; i += 8) {
+            a = _mm_crc32_u64(a, load(p + i));
+            b = _mm_crc32_u64(b, load(p + len + i));
+            c = _mm_crc32_u64(c, load(p + 2 * len + i));
+        }
+
+        crc = multiply(shift_operator(2 * len), static_cast<std::uint32_t>(a)) ^
+              multiply(shift_operator(len), static_cast<std::uint32_t>(b)) ^
+              static_cast<std::uint32_t>(c);
+        p += 3 * len;
+        n -= 3 * len;
+    }
+
+    std::uint64_t c = crc;
+
+    for(; n >= 8; p += 8, n -= 8) {
+        c = _mm_crc32_u64(c, load(p));
+    }
+
+    crc = static_cast<std::uint32_t>(c);
+
+    for(; n != 0; ++p, --n) {
+        crc = _mm_crc32_u8(crc, *p);
+    }
+
+    return crc;
+}
+
+#endif // __x86_64__
+
+std::uint32_t
+update(std::uint32_t crc, const unsigned char* p, std::size_t n) noexcept {
+
+#if defined(__x86_64__)
+    static const bool sse42 = [] {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("sse4.2") != 0;
+    }();
+
+    if(sse42) {
+        return update_sse42(crc, p, n);
+    }
+#endif
+
+    return update_table(crc, p, n);
+}
+
+} // namespace
+
+namespace posix_file {
+
+std::uint32_t
+crc32c(std::uint32_t crc, const void* data, std::size_t size) noexcept {
+    return ~update(~crc, static_cast<const unsigned char*>(data), size);
+}
+
+std::uint32_t
+crc32c_shift(std::uint32_t crc, std::uint64_t bytes) noexcept {
+    return multiply(shift_operator(bytes), crc);
+}
+
+} // namespace posix_file
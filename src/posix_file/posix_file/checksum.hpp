@@ -0,0 +1,111 @@
+/******************************************************************************
+ * Copyright 2022-2023, Barcelona Supercomputing Center (BSC), Spain
+ *
+ * This software was partially supported by the EuroHPC-funded project ADMIRE
+ *   (Project ID: 956748, https://www.admire-eurohpc.eu).
+ *
+ * This file is part of Cargo.
+ *
+ * Cargo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cargo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cargo.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *****************************************************************************/
+
+#ifndef POSIX_FILE_CHECKSUM_HPP
+#define POSIX_FILE_CHECKSUM_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include "types.hpp"
+#include "ranges.hpp"
+
+namespace posix_file {
+
+/**
+ * @brief Extend the CRC32C (Castagnoli) checksum `crc` with `size` bytes of
+ * `data`. The CRC32C of a buffer is `crc32c(0, data, size)`.
+ *
+ * CPUs with SSE 4.2 compute it with their `crc32` instruction, interleaving
+ * three independent streams for long buffers to hide its latency. Other CPUs
+ * fall back to a table-driven implementation.
+ */
+std::uint32_t
+crc32c(std::uint32_t crc, const void* data, std::size_t size) noexcept;
+
+/**
+ * @brief Compute the checksum that `crc` would be combined with when
+ * followed by `bytes` more bytes: for two buffers `a` and `b`,
+ * `crc32c(a + b) == crc32c_shift(crc32c(a), size(b)) ^ crc32c(b)`.
+ */
+std::uint32_t
+crc32c_shift(std::uint32_t crc, std::uint64_t bytes) noexcept;
+
+/**
+ * The CRC32C of a file assembled from the checksums of its ranges.
+ *
+ * Since the checksum of a range only needs to be shifted by the number of
+ * bytes that follow it in the file, ranges can be added in any order, and
+ * the digests of disjoint sets of ranges are combined with a XOR. Each
+ * worker can thus checksum the blocks it transfers as they complete, and
+ * the digest of the whole file is the XOR of the digests of all workers.
+ *
+ * For instance, for a file of 1024 bytes:
+ *
+ * ```cpp
+ * file_digest d{1024};
+ * d.add({512, 512}, crc32c(0, buf + 512, 512));
+ * d.add({0, 512}, crc32c(0, buf, 512));
+ * ```
+ *
+ * `d.value()` is equal to `crc32c(0, buf, 1024)`.
+ */
+class file_digest {
+
+public:
+    explicit file_digest(std::size_t file_size = 0) noexcept
+        : m_file_size(file_size) {}
+
+    // Add range `r`, whose data has checksum `crc`
+    void
+    add(const ranges::range& r, std::uint32_t crc) noexcept {
+        const auto end = static_cast<std::size_t>(r.offset()) + r.size();
+        m_value ^= crc32c_shift(crc, m_file_size - end);
+    }
+
+    // Add range `r` of a file hole, which reads as zeros
+    void
+    add_zeros(const ranges::range& r) noexcept {
+        add(r, crc32c_shift(~0u, r.size()) ^ ~0u);
+    }
+
+    // Add the digest of other ranges of the same file
+    void
+    merge(std::uint32_t digest) noexcept {
+        m_value ^= digest;
+    }
+
+    std::uint32_t
+    value() const noexcept {
+        return m_value;
+    }
+
+private:
+    std::size_t m_file_size;
+    std::uint32_t m_value = 0;
+};
+
+} // namespace posix_file
+
+#endif // POSIX_FILE_CHECKSUM_HPP
@@ -0,0 +1,211 @@
+/******************************************************************************
+ * Copyright 2022-2023, Barcelona Supercomputing Center (BSC), Spain
+ *
+ * This software was partially supported by the EuroHPC-funded project ADMIRE
+ *   (Project ID: 956748, https://www.admire-eurohpc.eu).
+ *
+ * This file is part of Cargo.
+ *
+ * Cargo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cargo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cargo.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *****************************************************************************/
+
+#include "container.hpp"
+
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+
+#ifdef ZSTD_COMPRESSION
+#include <zstd.h>
+#endif
+
+namespace {
+
+constexpr std::array<char, 8> magic = {'C', 'A', 'R', 'G', 'O', 'B', 'L', 'K'};
+constexpr std::uint32_t version = 1;
+
+enum class codec_type : std::uint32_t { stored = 0, zstd = 1 };
+
+// The header at the start of each slot, in native byte order
+struct slot_header {
+    std::array<char, 8> magic;
+    std::uint32_t version;
+    codec_type codec;
+    // layout of the container
+    std::uint64_t file_size;
+    std::uint64_t block_size;
+    // bytes of the original file in the slot, and bytes stored for them
+    std::uint64_t size;
+    std::uint64_t stored_size;
+    std::array<std::byte, 16> reserved;
+};
+
+static_assert(sizeof(slot_header) == posix_file::block_container::header_size);
+
+slot_header
+read_header(const void* slot) {
+    slot_header h;
+    std::memcpy(&h, slot, sizeof(h));
+    return h;
+}
+
+bool
+valid(const slot_header& h) {
+    return h.magic == magic && h.version == version &&
+           h.block_size > posix_file::block_container::header_size;
+}
+
+#ifdef ZSTD_COMPRESSION
+
+// zstd contexts are expensive to create, so each I/O thread keeps its own
+struct cctx_deleter {
+    void
+    operator()(ZSTD_CCtx* ctx) const noexcept {
+        ZSTD_freeCCtx(ctx);
+    }
+};
+
+struct dctx_deleter {
+    void
+    operator()(ZSTD_DCtx* ctx) const noexcept {
+        ZSTD_freeDCtx(ctx);
+    }
+};
+
+ZSTD_CCtx*
+compression_context() {
+    thread_local std::unique_ptr<ZSTD_CCtx, cctx_deleter> ctx{
+            ZSTD_createCCtx()};
+    return ctx.get();
+}
+
+ZSTD_DCtx*
+decompression_context() {
+    thread_local std::unique_ptr<ZSTD_DCtx, dctx_deleter> ctx{
+            ZSTD_createDCtx()};
+    return ctx.get();
+}
+
+#endif // ZSTD_COMPRESSION
+
+} // namespace
+
+namespace posix_file {
+
+bool
+block_container::supported() noexcept {
+#ifdef ZSTD_COMPRESSION
+    return true;
+#else
+    return false;
+#endif
+}
+
+std::optional<block_container>
+block_container::probe(const file& f) {
+
+    if(f.size() < header_size) {
+        return std::nullopt;
+    }
+
+    std::array<char, header_size> buffer;
+
+    if(f.pread(buffer, 0, header_size) != header_size) {
+        return std::nullopt;
+    }
+
+    const auto h = read_header(buffer.data());
+
+    if(!valid(h)) {
+        return std::nullopt;
+    }
+
+    return block_container{h.file_size, h.block_size};
+}
+
+std::size_t
+block_container::pack(const ranges::range& r, const void* data, void* slot,
+                      int level) const {
+
+    auto* const out = static_cast<std::byte*>(slot);
+
+    slot_header h{magic, version, codec_type::stored, m_file_size, m_block_size,
+                  r.size(), r.size(), {}};
+
+#ifdef ZSTD_COMPRESSION
+    const std::size_t n =
+            ZSTD_compressCCtx(compression_context(), out + header_size,
+                              payload_size(), data, r.size(), level);
+
+    // blocks that do not compress (or that do not fit in their slot once
+    // compressed) are stored as is
+    if(!ZSTD_isError(n) && n < r.size()) {
+        h.codec = codec_type::zstd;
+        h.stored_size = n;
+    }
+#else
+    (void) level;
+#endif
+
+    if(h.codec == codec_type::stored) {
+        std::memcpy(out + header_size, data, r.size());
+    }
+
+    std::memcpy(out, &h, sizeof(h));
+    return header_size + h.stored_size;
+}
+
+void
+block_container::unpack(const ranges::range& r, const void* slot,
+                        std::size_t size, void* data) const {
+
+    if(size < header_size) {
+        throw io_error("posix_file::block_container::unpack", EILSEQ);
+    }
+
+    const auto h = read_header(slot);
+    const auto* const in = static_cast<const std::byte*>(slot) + header_size;
+
+    if(!valid(h) || h.file_size != m_file_size ||
+       h.block_size != m_block_size || h.size != r.size() ||
+       h.stored_size > size - header_size) {
+        throw io_error("posix_file::block_container::unpack", EILSEQ);
+    }
+
+    switch(h.codec) {
+        case codec_type::stored:
+            if(h.stored_size != r.size()) {
+                break;
+            }
+            std::memcpy(data, in, r.size());
+            return;
+#ifdef ZSTD_COMPRESSION
+        case codec_type::zstd:
+            if(ZSTD_decompressDCtx(decompression_context(), data, r.size(),
+                                   in, h.stored_size) != r.size()) {
+                break;
+            }
+            return;
+#endif
+        default:
+            throw io_error("posix_file::block_container::unpack", ENOTSUP);
+    }
+
+    throw io_error("posix_file::block_container::unpack", EILSEQ);
+}
+
+} // namespace posix_file
@@ -0,0 +1,153 @@
+/******************************************************************************
+ * Copyright 2022-2023, Barcelona Supercomputing Center (BSC), Spain
+ *
+ * This software was partially supported by the EuroHPC-funded project ADMIRE
+ *   (Project ID: 956748, https://www.admire-eurohpc.eu).
+ *
+ * This file is part of Cargo.
+ *
+ * Cargo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cargo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cargo.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *****************************************************************************/
+
+#ifndef POSIX_FILE_CONTAINER_HPP
+#define POSIX_FILE_CONTAINER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include "types.hpp"
+#include "file.hpp"
+
+namespace posix_file {
+
+/**
+ * The layout of a block-compressed container.
+ *
+ * A container stores a file as a sequence of fixed-size slots, one for each
+ * block of the file. Each slot starts with a header of `header_size` bytes
+ * that describes the block, followed by its data compressed with zstd, or
+ * stored as is if it does not compress. A slot of `block_size` bytes thus
+ * holds a block of `payload_size() = block_size - header_size` bytes of the
+ * original file. The unused tail of each slot is never written and it is
+ * left as a hole.
+ *
+ * Since slot `i` is always at offset `i * block_size`, the blocks of a file
+ * can be compressed and written by several workers at once, and any block
+ * can be read back without going through the previous ones.
+ *
+ * For instance, for a file of 3000 bytes stored in slots of 1088 bytes:
+ *
+ * ```cpp
+ * block_container c{3000, 1088};
+ * ```
+ *
+ * `c.payload_size()` is 1024, and the range `{2048, 952}` of the file is
+ * stored in the slot `c.slot({2048, 952})`, that is, `{2176, 1088}`.
+ */
+class block_container {
+
+public:
+    static constexpr std::size_t header_size = 64;
+    // Slots are as large as the default stripe size of Lustre, so that each
+    // slot is written by a single worker
+    static constexpr std::size_t default_block_size = 1024 * 1024;
+    // Fast enough for the compression to keep up with the I/O threads
+    static constexpr int default_level = 1;
+
+    // Whether containers can be written and read, which requires zstd
+    static bool
+    supported() noexcept;
+
+    /**
+     * Read the layout of the container stored in file `f`.
+     *
+     * @return The layout of the container, or `std::nullopt` if `f` is not a
+     * container.
+     */
+    static std::optional<block_container>
+    probe(const file& f);
+
+    block_container(std::size_t file_size, std::size_t block_size) noexcept
+        : m_file_size(file_size), m_block_size(block_size) {}
+
+    // Size of the original file
+    std::size_t
+    file_size() const noexcept {
+        return m_file_size;
+    }
+
+    // Size of each slot
+    std::size_t
+    block_size() const noexcept {
+        return m_block_size;
+    }
+
+    // Bytes of the original file stored in each slot
+    std::size_t
+    payload_size() const noexcept {
+        return m_block_size - header_size;
+    }
+
+    // Size of the container file, including the unused tail of its slots
+    std::size_t
+    capacity() const noexcept {
+        return (m_file_size + payload_size() - 1) / payload_size() *
+               m_block_size;
+    }
+
+    // The slot that stores range `r` of the original file, which must be
+    // aligned to `payload_size()`
+    ranges::range
+    slot(const ranges::range& r) const noexcept {
+        const auto index = static_cast<std::size_t>(r.offset()) /
+                           payload_size();
+        return {static_cast<offset>(index * m_block_size), m_block_size};
+    }
+
+    /**
+     * Store range `r` of the original file in a slot.
+     *
+     * @param r The range of the original file.
+     * @param data The data in `r`.
+     * @param slot A buffer of `block_size()` bytes where the slot is built.
+     * @param level The zstd compression level.
+     * @return The number of bytes of `slot` that must be written.
+     */
+    std::size_t
+    pack(const ranges::range& r, const void* data, void* slot,
+         int level) const;
+
+    /**
+     * Extract range `r` of the original file from its slot.
+     *
+     * @param r The range of the original file.
+     * @param slot The first `size` bytes of the slot that stores `r`.
+     * @param size The number of bytes of the slot available.
+     * @param data A buffer of `r.size()` bytes for the data in `r`.
+     * @throws io_error with `EILSEQ` if the slot is corrupt.
+     */
+    void
+    unpack(const ranges::range& r, const void* slot, std::size_t size,
+           void* data) const;
+
+private:
+    std::size_t m_file_size;
+    std::size_t m_block_size;
+};
+
+} // namespace posix_file
+
+#endif // POSIX_FILE_CONTAINER_HPP
@@ -0,0 +1,131 @@
+/******************************************************************************
+ * Copyright 2022-2023, Barcelona Supercomputing Center (BSC), Spain
+ *
+ * This software was partially supported by the EuroHPC-funded project ADMIRE
+ *   (Project ID: 956748, https://www.admire-eurohpc.eu).
+ *
+ * This file is part of Cargo.
+ *
+ * Cargo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cargo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cargo.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *****************************************************************************/
+
+#ifndef POSIX_FILE_EXTENTS_HPP
+#define POSIX_FILE_EXTENTS_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <optional>
+#include <vector>
+#include "types.hpp"
+#include "ranges.hpp"
+
+namespace posix_file {
+
+/**
+ * The data extents of a (possibly sparse) file.
+ *
+ * An `extent_map` records which ranges of a file hold data, so that the
+ * ranges of a block decomposition that only cover holes can be skipped, and
+ * those that partially cover holes can be trimmed.
+ *
+ * For instance, for a file of 4096 bytes with data in `[1024, 1536)` only:
+ *
+ * ```cpp
+ * extent_map m{{ranges::range{1024, 512}}};
+ * ```
+ *
+ * `m.data_in({0, 1024})` returns `std::nullopt`, and
+ * `m.data_in({512, 2048})` returns `{1024, 512}`.
+ */
+class extent_map {
+
+public:
+    extent_map() = default;
+
+    /**
+     * Construct a map from the data extents of a file.
+     *
+     * @param extents The data extents of the file, sorted by offset and not
+     * overlapping.
+     */
+    explicit extent_map(std::vector<ranges::range> extents)
+        : m_extents(std::move(extents)) {}
+
+    const std::vector<ranges::range>&
+    extents() const noexcept {
+        return m_extents;
+    }
+
+    /**
+     * Return the number of bytes of the file that hold data.
+     *
+     * @return The sum of the sizes of all extents.
+     */
+    std::size_t
+    data_size() const noexcept {
+        std::size_t n = 0;
+        for(const auto& e : m_extents) {
+            n += e.size();
+        }
+        return n;
+    }
+
+    /**
+     * Return the smallest range that contains all the data in `r`.
+     *
+     * @param r A file range.
+     * @return The part of `r` between the first and the last byte of data it
+     * contains, or `std::nullopt` if `r` only covers holes.
+     */
+    std::optional<ranges::range>
+    data_in(const ranges::range& r) const {
+
+        const offset begin = r.offset();
+        const offset end = r.offset() + r.size();
+
+        // first extent ending after `begin`
+        auto first = std::upper_bound(
+                m_extents.begin(), m_extents.end(), begin,
+                [](offset o, const ranges::range& e) {
+                    return o < e.offset() + e.size();
+                });
+
+        if(first == m_extents.end() || first->offset() >= end) {
+            return std::nullopt;
+        }
+
+        // last extent starting before `end`
+        auto last = std::prev(std::lower_bound(
+                first, m_extents.end(), end,
+                [](const ranges::range& e, offset o) {
+                    return e.offset() < o;
+                }));
+
+        const offset data_begin = std::max(begin, first->offset());
+        const offset data_end =
+                std::min<offset>(end, last->offset() + last->size());
+
+        return ranges::range{data_begin,
+                             static_cast<std::size_t>(data_end - data_begin)};
+    }
+
+private:
+    std::vector<ranges::range> m_extents;
+};
+
+} // namespace posix_file
+
+#endif // POSIX_FILE_EXTENTS_HPP
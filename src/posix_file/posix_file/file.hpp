@@ -26,6 +26,7 @@
 #define POSIX_FILE_FILE_HPP
 
 #include "types.hpp"
+#include "extents.hpp"
 
 #include <filesystem>
 #include <utility>
@@ -189,6 +190,21 @@ public:
         return m_fs_plugin->unlink(m_path);
     }
 
+    /**
+     * @brief Retrieves the status of the file from its file system.
+     */
+    struct stat
+    status() const {
+
+        struct stat buf {};
+
+        if(m_fs_plugin->stat(m_path, &buf) == -1) {
+            throw io_error("posix_file::file::status", errno);
+        }
+
+        return buf;
+    }
+
     void
     fallocate(int mode, offset offset, std::size_t len) const {
 
@@ -204,11 +220,113 @@ public:
         }
     }
 
+    /**
+     * @brief Finds the regions of the file that hold data.
+     * @return the data extents of the file, which cover the whole file if
+     * its file system cannot report holes
+     */
+    extent_map
+    extents() const {
+
+        if(!m_handle) {
+            throw io_error("posix_file::file::extents", EBADF);
+        }
+
+        std::vector<ranges::range> extents;
+
+        for(const auto& [offset, length] : m_fs_plugin->data_extents(
+                    m_handle.native(), static_cast<off_t>(size()))) {
+            extents.emplace_back(static_cast<posix_file::offset>(offset),
+                                 static_cast<std::size_t>(length));
+        }
+
+        return extent_map{std::move(extents)};
+    }
+
+    /**
+     * @brief Sets the size of the file without allocating storage for it.
+     * @return false if the file system does not support sparse files
+     */
+    bool
+    truncate(std::size_t len) const {
+
+        if(!m_handle) {
+            throw io_error("posix_file::file::truncate", EBADF);
+        }
+
+        if(m_fs_plugin->ftruncate(m_handle.native(),
+                                  static_cast<off_t>(len)) == -1) {
+            if(errno == ENOTSUP) {
+                return false;
+            }
+            throw io_error("posix_file::file::truncate", errno);
+        }
+
+        return true;
+    }
+
+    /**
+     * @brief Turns `[offset, offset + len)` into a hole, keeping the file size.
+     * @return false if the file system does not support holes
+     */
+    bool
+    punch_hole(offset offset, std::size_t len) const {
+
+        if(!m_handle) {
+            throw io_error("posix_file::file::punch_hole", EBADF);
+        }
+
+        if(m_fs_plugin->punch_hole(m_handle.native(),
+                                   static_cast<off_t>(offset),
+                                   static_cast<off_t>(len)) == -1) {
+            if(errno == ENOTSUP) {
+                return false;
+            }
+            throw io_error("posix_file::file::punch_hole", errno);
+        }
+
+        return true;
+    }
+
+    /**
+     * @brief Flushes the data written to the file to stable storage.
+     * @return false if the file system cannot flush it on demand
+     */
+    bool
+    sync() const {
+
+        if(!m_handle) {
+            throw io_error("posix_file::file::sync", EBADF);
+        }
+
+        if(m_fs_plugin->fdatasync(m_handle.native()) == -1) {
+            if(errno == ENOTSUP) {
+                return false;
+            }
+            throw io_error("posix_file::file::sync", errno);
+        }
+
+        return true;
+    }
+
     void
     close() noexcept {
         m_fs_plugin->close(m_handle.native());
     }
 
+    /**
+     * @brief Returns the kernel file descriptor for this file.
+     * @return the file descriptor, or -1 if the file is not open or if it is
+     * managed by a plugin that does not use kernel file descriptors
+     */
+    [[nodiscard]] int
+    native_handle() const noexcept {
+        if(!m_handle || !m_fs_plugin->native_fds()) {
+            return -1;
+        }
+        return m_handle.native();
+    }
+
     template <typename MemoryBuffer>
     std::size_t
     pread(MemoryBuffer&& buf, offset offset, std::size_t size) const {
@@ -6,6 +6,7 @@
 #include <filesystem>
 #include <utility>
 #include <fcntl.h>
+#include <cerrno>
 
 namespace cargo {
 class FSPlugin {
@@ -47,6 +48,57 @@ public:
     stat(const std::string& path, struct stat* buf) = 0;
     virtual ssize_t
     size(const std::string& path) = 0;
+
+    // Whether the descriptors returned by `open()` are kernel file
+    // descriptors that can be passed directly to system calls
+    virtual bool
+    native_fds() const noexcept {
+        return false;
+    }
+
+    // The regions of the open file `fd` (of `size` bytes) that hold data, as
+    // (offset, length) pairs sorted by offset. Plugins that cannot tell holes
+    // apart from data report the whole file as a single region
+    virtual std::vector<std::pair<off_t, off_t>>
+    data_extents(int fd, off_t size) {
+        (void) fd;
+        if(size <= 0) {
+            return {};
+        }
+        return {{0, size}};
+    }
+
+    // Set the size of `fd` to `length` without allocating storage for it.
+    // Returns -1 with `errno` set to ENOTSUP if the plugin cannot create
+    // sparse files
+    virtual int
+    ftruncate(int fd, off_t length) {
+        (void) fd;
+        (void) length;
+        errno = ENOTSUP;
+        return -1;
+    }
+
+    // Release the storage of `len` bytes of `fd` starting at `offset`,
+    // keeping the file size. Returns -1 with `errno` set to ENOTSUP if the
+    // plugin cannot create holes
+    virtual int
+    punch_hole(int fd, off_t offset, off_t len) {
+        (void) fd;
+        (void) offset;
+        (void) len;
+        errno = ENOTSUP;
+        return -1;
+    }
+
+    // Flush the data written to `fd` to stable storage. Returns -1 with
+    // `errno` set to ENOTSUP if the plugin cannot flush data on demand
+    virtual int
+    fdatasync(int fd) {
+        (void) fd;
+        errno = ENOTSUP;
+        return -1;
+    }
 };
 } // namespace cargo
 #endif // FS_PLUGIN_HPP
\ No newline at end of file
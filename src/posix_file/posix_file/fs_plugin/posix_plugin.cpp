@@ -2,6 +2,7 @@
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <algorithm>
 #include "posix_plugin.hpp"
 
 namespace cargo {
@@ -71,4 +72,62 @@ posix_plugin::size(const std::string& path) {
     return std::filesystem::file_size(path);
 }
 
+bool
+posix_plugin::native_fds() const noexcept {
+    return true;
+}
+
+std::vector<std::pair<off_t, off_t>>
+posix_plugin::data_extents(int fd, off_t size) {
+
+    std::vector<std::pair<off_t, off_t>> extents;
+
+    for(off_t offset = 0; offset < size;) {
+
+        const off_t data = ::lseek(fd, offset, SEEK_DATA);
+
+        if(data == -1) {
+            // ENXIO: there is no more data until EOF
+            if(errno == ENXIO) {
+                break;
+            }
+            // the file system does not support SEEK_DATA: assume that the
+            // file is dense
+            return FSPlugin::data_extents(fd, size);
+        }
+
+        if(data >= size) {
+            break;
+        }
+
+        const off_t hole = ::lseek(fd, data, SEEK_HOLE);
+
+        if(hole == -1) {
+            return FSPlugin::data_extents(fd, size);
+        }
+
+        const off_t end = std::min(hole, size);
+        extents.emplace_back(data, end - data);
+        offset = end;
+    }
+
+    return extents;
+}
+
+int
+posix_plugin::ftruncate(int fd, off_t length) {
+    return ::ftruncate(fd, length);
+}
+
+int
+posix_plugin::punch_hole(int fd, off_t offset, off_t len) {
+    return ::fallocate(fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, offset,
+                       len);
+}
+
+int
+posix_plugin::fdatasync(int fd) {
+    return ::fdatasync(fd);
+}
+
 }; // namespace cargo
\ No newline at end of file
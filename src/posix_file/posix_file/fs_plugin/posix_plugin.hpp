@@ -33,6 +33,21 @@ public:
 
     ssize_t
     size(const std::string& path) final;
+
+    bool
+    native_fds() const noexcept final;
+
+    std::vector<std::pair<off_t, off_t>>
+    data_extents(int fd, off_t size) final;
+
+    int
+    ftruncate(int fd, off_t length) final;
+
+    int
+    punch_hole(int fd, off_t offset, off_t len) final;
+
+    int
+    fdatasync(int fd) final;
 };
 } // namespace cargo
 #endif // POSIX_PLUGIN_HPP
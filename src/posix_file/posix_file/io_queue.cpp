@@ -0,0 +1,579 @@
+/******************************************************************************
+ * Copyright 2022-2023, Barcelona Supercomputing Center (BSC), Spain
+ *
+ * This software was partially supported by the EuroHPC-funded project ADMIRE
+ *   (Project ID: 956748, https://www.admire-eurohpc.eu).
+ *
+ * This file is part of Cargo.
+ *
+ * Cargo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cargo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cargo.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *****************************************************************************/
+
+
+#include "io_queue.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <vector>
+
+#if __has_include(<linux/io_uring.h>)
+#define POSIX_FILE_HAVE_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#endif
+
+namespace posix_file {
+
+namespace {
+
+// number of fixed file slots registered for each queue
+constexpr unsigned int fixed_file_slots = 16;
+
+// user_data layout: ticket << 1 | (1 if the SQE is the write of a copy)
+constexpr std::uint64_t
+make_user_data(io_queue::ticket t, bool second) {
+    return (t << 1u) | (second ? 1u : 0u);
+}
+
+} // namespace
+
+#ifdef POSIX_FILE_HAVE_IO_URING
+
+/**
+ * The state of an io_uring instance, set up directly through the
+ * `io_uring_setup(2)`, `io_uring_enter(2)` and `io_uring_register(2)`
+ * system calls.
+ */
+struct io_queue::ring {
+
+    static std::unique_ptr<ring>
+    create(unsigned int depth) {
+
+        auto r = std::make_unique<ring>();
+        io_uring_params params{};
+        params.flags = IORING_SETUP_CLAMP;
+
+        r->fd = static_cast<int>(
+                ::syscall(__NR_io_uring_setup, std::max(depth, 1u), &params));
+
+        if(r->fd < 0) {
+            return {};
+        }
+
+        r->entries = params.sq_entries;
+        r->sq_len = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        r->cq_len = params.cq_off.cqes +
+                    params.cq_entries * sizeof(io_uring_cqe);
+
+        const bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+
+        if(single_mmap) {
+            r->sq_len = r->cq_len = std::max(r->sq_len, r->cq_len);
+        }
+
+        r->sq_ptr = ::mmap(nullptr, r->sq_len, PROT_READ | PROT_WRITE,
+                           MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQ_RING);
+
+        if(r->sq_ptr == MAP_FAILED) {
+            r->sq_ptr = nullptr;
+            return {};
+        }
+
+        if(single_mmap) {
+            r->cq_ptr = r->sq_ptr;
+        } else {
+            r->cq_ptr = ::mmap(nullptr, r->cq_len, PROT_READ | PROT_WRITE,
+                               MAP_SHARED | MAP_POPULATE, r->fd,
+                               IORING_OFF_CQ_RING);
+            if(r->cq_ptr == MAP_FAILED) {
+                r->cq_ptr = nullptr;
+                return {};
+            }
+        }
+
+        r->sqes_len = params.sq_entries * sizeof(io_uring_sqe);
+        void* sqes = ::mmap(nullptr, r->sqes_len, PROT_READ | PROT_WRITE,
+                            MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQES);
+
+        if(sqes == MAP_FAILED) {
+            return {};
+        }
+
+        r->sqes = static_cast<io_uring_sqe*>(sqes);
+
+        auto* sq = static_cast<char*>(r->sq_ptr);
+        r->sq_head = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+        r->sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        r->sq_mask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        r->sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+
+        auto* cq = static_cast<char*>(r->cq_ptr);
+        r->cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        r->cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        r->cq_mask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        r->cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+        // register an empty table of fixed files that is filled on demand.
+        // Older kernels do not support sparse tables, in which case plain
+        // file descriptors are used
+        r->files.assign(fixed_file_slots, -1);
+        r->fixed_files =
+                r->register_op(IORING_REGISTER_FILES, r->files.data(),
+                               static_cast<unsigned>(r->files.size())) == 0;
+
+        return r;
+    }
+
+    ~ring() {
+        if(sqes) {
+            ::munmap(sqes, sqes_len);
+        }
+        if(cq_ptr && cq_ptr != sq_ptr) {
+            ::munmap(cq_ptr, cq_len);
+        }
+        if(sq_ptr) {
+            ::munmap(sq_ptr, sq_len);
+        }
+        if(fd >= 0) {
+            ::close(fd);
+        }
+    }
+
+    int
+    register_op(unsigned int opcode, const void* arg, unsigned int nr_args) {
+        return static_cast<int>(
+                ::syscall(__NR_io_uring_register, fd, opcode, arg, nr_args));
+    }
+
+    int
+    enter(unsigned int to_submit, unsigned int min_complete) {
+        const unsigned int flags = min_complete ? IORING_ENTER_GETEVENTS : 0;
+        int ret;
+        do {
+            ret = static_cast<int>(::syscall(__NR_io_uring_enter, fd,
+                                             to_submit, min_complete, flags,
+                                             nullptr, 0));
+        } while(ret < 0 && errno == EINTR);
+        return ret;
+    }
+
+    // Return the fixed file slot for `native_fd`, registering it if needed,
+    // or -1 if it could not be registered
+    int
+    file_slot(int native_fd) {
+
+        if(!fixed_files) {
+            return -1;
+        }
+
+        if(const auto it = std::find(files.begin(), files.end(), native_fd);
+           it != files.end()) {
+            return static_cast<int>(std::distance(files.begin(), it));
+        }
+
+        const auto it = std::find(files.begin(), files.end(), -1);
+
+        if(it == files.end()) {
+            return -1;
+        }
+
+        io_uring_files_update update{};
+        update.offset = static_cast<unsigned>(std::distance(files.begin(), it));
+        update.fds = reinterpret_cast<std::uintptr_t>(&native_fd);
+
+        if(register_op(IORING_REGISTER_FILES_UPDATE, &update, 1) != 1) {
+            return -1;
+        }
+
+        *it = native_fd;
+        return static_cast<int>(update.offset);
+    }
+
+    // Unregister the fixed file slot of `native_fd`, if it has one, so that
+    // the descriptor can be reused by another file
+    void
+    release_slot(int native_fd) {
+
+        const auto it = std::find(files.begin(), files.end(), native_fd);
+
+        if(native_fd == -1 || it == files.end()) {
+            return;
+        }
+
+        int none = -1;
+        io_uring_files_update update{};
+        update.offset = static_cast<unsigned>(std::distance(files.begin(), it));
+        update.fds = reinterpret_cast<std::uintptr_t>(&none);
+
+        // if the update fails, the slot is kept so that it is never handed
+        // out for another file
+        if(register_op(IORING_REGISTER_FILES_UPDATE, &update, 1) == 1) {
+            *it = -1;
+        } else {
+            *it = -2;
+        }
+    }
+
+    // Fill the next SQE for an I/O on `native_fd` using `buf`
+    io_uring_sqe*
+    next_sqe(bool write, int native_fd, std::span<char> buf, offset off,
+             std::size_t size, std::uint64_t user_data) {
+
+        const unsigned int tail = *sq_tail;
+        const unsigned int index = tail & *sq_mask;
+        io_uring_sqe* sqe = &sqes[index];
+
+        std::memset(sqe, 0, sizeof(*sqe));
+
+        const bool fixed_buffer =
+                buffer.data() != nullptr && buf.data() >= buffer.data() &&
+                buf.data() + size <= buffer.data() + buffer.size();
+
+        if(fixed_buffer) {
+            sqe->opcode = write ? IORING_OP_WRITE_FIXED : IORING_OP_READ_FIXED;
+            sqe->buf_index = 0;
+        } else {
+            sqe->opcode = write ? IORING_OP_WRITE : IORING_OP_READ;
+        }
+
+        if(const int slot = file_slot(native_fd); slot != -1) {
+            sqe->fd = slot;
+            sqe->flags |= IOSQE_FIXED_FILE;
+        } else {
+            sqe->fd = native_fd;
+        }
+
+        sqe->addr = reinterpret_cast<std::uintptr_t>(buf.data());
+        sqe->len = static_cast<std::uint32_t>(size);
+        sqe->off = off;
+        sqe->user_data = user_data;
+
+        sq_array[index] = index;
+        __atomic_store_n(sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+        ++pending;
+        ++in_flight;
+        return sqe;
+    }
+
+    int fd = -1;
+    unsigned int entries = 0;
+
+    void* sq_ptr = nullptr;
+    std::size_t sq_len = 0;
+    unsigned* sq_head = nullptr;
+    unsigned* sq_tail = nullptr;
+    unsigned* sq_mask = nullptr;
+    unsigned* sq_array = nullptr;
+    io_uring_sqe* sqes = nullptr;
+    std::size_t sqes_len = 0;
+
+    void* cq_ptr = nullptr;
+    std::size_t cq_len = 0;
+    unsigned* cq_head = nullptr;
+    unsigned* cq_tail = nullptr;
+    unsigned* cq_mask = nullptr;
+    io_uring_cqe* cqes = nullptr;
+
+    // SQEs prepared but not yet submitted
+    unsigned int pending = 0;
+    // SQEs whose completion has not been reaped yet
+    unsigned int in_flight = 0;
+
+    std::span<char> buffer;
+    std::vector<int> files;
+    bool fixed_files = false;
+};
+
+#else
+
+struct io_queue::ring {
+    static std::unique_ptr<ring>
+    create(unsigned int) {
+        return {};
+    }
+};
+
+#endif // POSIX_FILE_HAVE_IO_URING
+
+io_queue::io_queue(unsigned int depth) : m_ring(ring::create(depth)) {}
+
+io_queue::~io_queue() {
+#ifdef POSIX_FILE_HAVE_IO_URING
+    // the kernel may still be using buffers owned by the caller
+    if(m_ring) {
+        m_ring->enter(m_ring->pending, 0);
+        m_ring->pending = 0;
+        while(m_ring->in_flight != 0) {
+            reap(1);
+        }
+    }
+#endif
+}
+
+bool
+io_queue::async() const noexcept {
+    return m_ring != nullptr;
+}
+
+bool
+io_queue::async(const file& f) const noexcept {
+    return async() && f.native_handle() != -1;
+}
+
+void
+io_queue::release(const file& f) noexcept {
+#ifdef POSIX_FILE_HAVE_IO_URING
+    if(m_ring) {
+        m_ring->release_slot(f.native_handle());
+    }
+#else
+    (void) f;
+#endif
+}
+
+bool
+io_queue::register_buffer(std::span<char> buffer) noexcept {
+#ifdef POSIX_FILE_HAVE_IO_URING
+    if(!m_ring || m_ring->in_flight != 0) {
+        return false;
+    }
+
+    if(m_ring->buffer.data() != nullptr) {
+        m_ring->register_op(IORING_UNREGISTER_BUFFERS, nullptr, 0);
+        m_ring->buffer = {};
+    }
+
+    const iovec iov{buffer.data(), buffer.size()};
+
+    // this may fail (e.g. if the buffer exceeds RLIMIT_MEMLOCK), in which
+    // case requests simply use non-fixed operations
+    if(m_ring->register_op(IORING_REGISTER_BUFFERS, &iov, 1) != 0) {
+        return false;
+    }
+
+    m_ring->buffer = buffer;
+    return true;
+#else
+    (void) buffer;
+    return false;
+#endif
+}
+
+io_queue::ticket
+io_queue::read(const file& f, std::span<char> buf, offset offset,
+               std::size_t size) {
+    return enqueue(request{kind::read, &f, nullptr, buf, offset, size});
+}
+
+io_queue::ticket
+io_queue::write(const file& f, std::span<char> buf, offset offset,
+                std::size_t size) {
+    return enqueue(request{kind::write, nullptr, &f, buf, offset, size});
+}
+
+io_queue::ticket
+io_queue::copy(const file& in, const file& out, std::span<char> buf,
+               offset offset, std::size_t size) {
+    return enqueue(request{kind::copy, &in, &out, buf, offset, size});
+}
+
+io_queue::ticket
+io_queue::enqueue(request r) {
+
+    assert(r.buf.size() >= r.size);
+
+    const ticket t = m_next_ticket++;
+    auto& req = m_requests.emplace(t, r).first->second;
+
+    const bool use_ring = async() && (!req.in || async(*req.in)) &&
+                          (!req.out || async(*req.out));
+
+    if(!use_ring) {
+        run_sync(req);
+        return t;
+    }
+
+    prepare(t, req);
+    return t;
+}
+
+void
+io_queue::prepare(ticket t, request& r) {
+#ifdef POSIX_FILE_HAVE_IO_URING
+    const unsigned int needed = r.type == kind::copy ? 2 : 1;
+
+    // make room in the rings: the completion queue is at least as large as
+    // the submission queue, so bounding the SQEs in flight to the latter
+    // ensures that no completion is ever dropped
+    while(m_ring->in_flight + needed > m_ring->entries) {
+        submit();
+        reap(1);
+    }
+
+    switch(r.type) {
+        case kind::read:
+            m_ring->next_sqe(false, r.in->native_handle(), r.buf, r.off,
+                             r.size, make_user_data(t, false));
+            break;
+        case kind::write:
+            m_ring->next_sqe(true, r.out->native_handle(), r.buf, r.off,
+                             r.size, make_user_data(t, false));
+            break;
+        case kind::copy: {
+            auto* sqe = m_ring->next_sqe(false, r.in->native_handle(), r.buf,
+                                         r.off, r.size,
+                                         make_user_data(t, false));
+            // only start the write once the read has completed
+            sqe->flags |= IOSQE_IO_LINK;
+            m_ring->next_sqe(true, r.out->native_handle(), r.buf, r.off,
+                             r.size, make_user_data(t, true));
+            break;
+        }
+    }
+
+    r.pending = needed;
+#else
+    (void) t;
+    run_sync(r);
+#endif
+}
+
+void
+io_queue::submit() {
+#ifdef POSIX_FILE_HAVE_IO_URING
+    if(!m_ring || m_ring->pending == 0) {
+        return;
+    }
+
+    const int ret = m_ring->enter(m_ring->pending, 0);
+
+    if(ret < 0) {
+        throw io_error("posix_file::io_queue::submit", errno);
+    }
+
+    m_ring->pending -= static_cast<unsigned int>(ret);
+#endif
+}
+
+void
+io_queue::reap(unsigned int min_complete) {
+#ifdef POSIX_FILE_HAVE_IO_URING
+    unsigned int head = *m_ring->cq_head;
+
+    if(min_complete != 0 &&
+       head == __atomic_load_n(m_ring->cq_tail, __ATOMIC_ACQUIRE)) {
+        if(m_ring->enter(m_ring->pending, min_complete) < 0) {
+            throw io_error("posix_file::io_queue::wait", errno);
+        }
+        m_ring->pending = 0;
+    }
+
+    const unsigned int tail = __atomic_load_n(m_ring->cq_tail, __ATOMIC_ACQUIRE);
+
+    for(; head != tail; ++head) {
+        const io_uring_cqe& cqe = m_ring->cqes[head & *m_ring->cq_mask];
+        --m_ring->in_flight;
+        complete(cqe.user_data, cqe.res);
+    }
+
+    __atomic_store_n(m_ring->cq_head, head, __ATOMIC_RELEASE);
+#else
+    (void) min_complete;
+#endif
+}
+
+void
+io_queue::complete(std::uint64_t user_data, std::int32_t res) {
+
+    const auto it = m_requests.find(user_data >> 1u);
+
+    if(it == m_requests.end()) {
+        return;
+    }
+
+    request& r = it->second;
+    const bool second = user_data & 1u;
+
+    if(r.type == kind::copy && !second) {
+        r.read_result = res;
+    }
+
+    if(--r.pending != 0) {
+        return;
+    }
+
+    const std::int64_t result = r.type == kind::copy ? r.read_result : res;
+
+    if(result == static_cast<std::int64_t>(r.size) &&
+       (r.type != kind::copy || res == static_cast<std::int32_t>(r.size))) {
+        r.result = r.size;
+        return;
+    }
+
+    // short transfers (and the write of a copy whose read came back short,
+    // which the kernel cancels) are completed synchronously, which also
+    // reports any error through errno
+    run_sync(r);
+}
+
+void
+io_queue::run_sync(request& r) {
+    try {
+        switch(r.type) {
+            case kind::read:
+                r.result = r.in->pread(r.buf, r.off, r.size);
+                break;
+            case kind::write:
+                r.result = r.out->pwrite(r.buf, r.off, r.size);
+                break;
+            case kind::copy:
+                r.result = r.in->pread(r.buf, r.off, r.size);
+                r.out->pwrite(r.buf, r.off, r.size);
+                break;
+        }
+    } catch(const io_error& e) {
+        r.error = static_cast<int>(e.error_code());
+    }
+    r.pending = 0;
+}
+
+std::size_t
+io_queue::wait(ticket t) {
+
+    auto it = m_requests.find(t);
+    assert(it != m_requests.end());
+
+    while(it->second.pending != 0) {
+        submit();
+        reap(1);
+    }
+
+    const request r = it->second;
+    m_requests.erase(it);
+
+    if(r.error != 0) {
+        throw io_error("posix_file::io_queue::wait", r.error);
+    }
+
+    return r.result;
+}
+
+} // namespace posix_file
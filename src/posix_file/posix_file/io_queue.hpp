@@ -0,0 +1,172 @@
+/******************************************************************************
+ * Copyright 2022-2023, Barcelona Supercomputing Center (BSC), Spain
+ *
+ * This software was partially supported by the EuroHPC-funded project ADMIRE
+ *   (Project ID: 956748, https://www.admire-eurohpc.eu).
+ *
+ * This file is part of Cargo.
+ *
+ * Cargo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cargo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cargo.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *****************************************************************************/
+
+
+#ifndef POSIX_FILE_IO_QUEUE_HPP
+#define POSIX_FILE_IO_QUEUE_HPP
+
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <unordered_map>
+#include "file.hpp"
+
+namespace posix_file {
+
+/**
+ * A queue of asynchronous block requests on `posix_file::file` objects.
+ *
+ * When the kernel supports it and the files involved use kernel file
+ * descriptors (see `file::native_handle()`), requests are batched into an
+ * io_uring submission queue, so that a single thread can keep up to `depth`
+ * of them in flight. Files are registered as fixed files on first use, and a
+ * buffer can be registered so that requests inside it avoid pinning their
+ * pages on every I/O.
+ *
+ * Otherwise, requests are executed synchronously through the file's plugin
+ * when they are queued, so callers can use the same interface regardless of
+ * the backend.
+ *
+ * @remark Files and buffers passed to a queue must remain valid until the
+ * corresponding requests have been waited for, and files must remain open
+ * for the lifetime of the queue unless they are released first.
+ */
+class io_queue {
+
+public:
+    using ticket = std::uint64_t;
+
+    explicit io_queue(unsigned int depth);
+
+    io_queue(const io_queue&) = delete;
+    io_queue&
+    operator=(const io_queue&) = delete;
+
+    ~io_queue();
+
+    /**
+     * @brief Checks whether requests are executed asynchronously.
+     * @return true if the io_uring backend is in use
+     */
+    [[nodiscard]] bool
+    async() const noexcept;
+
+    /**
+     * @brief Checks whether requests on `f` can be executed asynchronously.
+     * @return true if the io_uring backend is in use and `f` is backed by a
+     * kernel file descriptor
+     */
+    [[nodiscard]] bool
+    async(const file& f) const noexcept;
+
+    /**
+     * @brief Unregisters the fixed file slot of `f`, if it was given one, so
+     * that `f` can be closed and its descriptor reused by another file. All
+     * requests on `f` must have been waited for.
+     */
+    void
+    release(const file& f) noexcept;
+
+    /**
+     * @brief Registers `buffer` with the kernel. Requests using memory inside
+     * it are then issued as fixed-buffer operations.
+     * @return true if the buffer could be registered
+     */
+    bool
+    register_buffer(std::span<char> buffer) noexcept;
+
+    ticket
+    read(const file& f, std::span<char> buf, offset offset, std::size_t size);
+
+    ticket
+    write(const file& f, std::span<char> buf, offset offset, std::size_t size);
+
+    /**
+     * @brief Queue a copy of `size` bytes at `offset` from `in` into the same
+     * offset of `out`, using `buf` as a staging buffer. The read and the write
+     * are linked so that the write is started by the kernel as soon as the
+     * read completes.
+     */
+    ticket
+    copy(const file& in, const file& out, std::span<char> buf, offset offset,
+         std::size_t size);
+
+    /**
+     * @brief Submit all queued requests to the kernel without waiting for
+     * them.
+     */
+    void
+    submit();
+
+    /**
+     * @brief Wait for the request identified by `t` to complete.
+     * @return the number of bytes transferred (read, for copies)
+     * @throws io_error if the request failed
+     */
+    std::size_t
+    wait(ticket t);
+
+private:
+    enum class kind { read, write, copy };
+
+    struct request {
+        kind type;
+        const file* in;
+        const file* out;
+        std::span<char> buf;
+        offset off;
+        std::size_t size;
+        // number of kernel completions still expected
+        unsigned int pending = 0;
+        // result reported by the kernel for the read half of a copy
+        std::int64_t read_result = 0;
+        std::size_t result = 0;
+        int error = 0;
+    };
+
+    struct ring;
+
+    ticket
+    enqueue(request r);
+
+    void
+    prepare(ticket t, request& r);
+
+    void
+    complete(std::uint64_t user_data, std::int32_t res);
+
+    void
+    reap(unsigned int min_complete);
+
+    static void
+    run_sync(request& r);
+
+    std::unique_ptr<ring> m_ring;
+    std::unordered_map<ticket, request> m_requests;
+    ticket m_next_ticket = 0;
+};
+
+} // namespace posix_file
+
+#endif // POSIX_FILE_IO_QUEUE_HPP
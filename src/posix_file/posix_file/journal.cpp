@@ -0,0 +1,293 @@
+/******************************************************************************
+ * Copyright 2022-2023, Barcelona Supercomputing Center (BSC), Spain
+ *
+ * This software was partially supported by the EuroHPC-funded project ADMIRE
+ *   (Project ID: 956748, https://www.admire-eurohpc.eu).
+ *
+ * This file is part of Cargo.
+ *
+ * Cargo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cargo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cargo.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *****************************************************************************/
+
+#include "journal.hpp"
+#include "checksum.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <optional>
+#include <span>
+#include <string>
+
+namespace {
+
+constexpr std::array<char, 8> magic = {'C', 'A', 'R', 'G', 'O', 'J', 'N', 'L'};
+constexpr std::uint32_t version = 2;
+
+// The header at the start of each journal, in native byte order. It is
+// followed by the paths of the output and input files and by the bitmap of
+// the blocks
+struct journal_header {
+    std::array<char, 8> magic;
+    std::uint32_t version;
+    std::uint32_t path_size;
+    std::uint64_t file_size;
+    std::uint64_t block_size;
+    std::uint64_t blocks;
+    std::uint32_t input_path_size;
+    std::uint32_t reserved;
+    std::uint64_t input_inode;
+    // in nanoseconds since the epoch
+    std::uint64_t input_mtime;
+};
+
+// The identity of the data of an input file
+struct input_identity {
+    std::string path;
+    std::uint64_t inode;
+    std::uint64_t mtime;
+
+    bool
+    operator==(const input_identity&) const = default;
+};
+
+// The identity of `input`, or none if its file system cannot tell when it
+// was modified, in which case no journal can be resumed for it
+std::optional<input_identity>
+identify(const posix_file::file& input) {
+
+    try {
+        const auto st = input.status();
+        return input_identity{
+                input.path().native(), static_cast<std::uint64_t>(st.st_ino),
+                static_cast<std::uint64_t>(st.st_mtim.tv_sec) * 1000000000u +
+                        static_cast<std::uint64_t>(st.st_mtim.tv_nsec)};
+    } catch(const posix_file::io_error&) {
+        return std::nullopt;
+    }
+}
+
+std::size_t
+block_count(std::size_t file_size, std::size_t block_size) {
+    return (file_size + block_size - 1) / block_size;
+}
+
+bool
+test(const std::vector<std::uint8_t>& bitmap, std::size_t i) {
+    return (bitmap[i / 8] >> (i % 8)) & 1u;
+}
+
+// The union of the bitmaps of the journals of `output` found in `dir`, for
+// each block size
+std::map<std::size_t, std::vector<std::uint8_t>>
+load(const std::filesystem::path& dir, const std::string& output,
+     const input_identity& input, std::size_t file_size) {
+
+    std::map<std::size_t, std::vector<std::uint8_t>> result;
+    std::error_code ec;
+
+    for(const auto& entry : std::filesystem::directory_iterator{dir, ec}) {
+
+        std::ifstream in{entry.path(), std::ios::binary};
+        journal_header h;
+
+        if(!in.read(reinterpret_cast<char*>(&h), sizeof(h)) ||
+           h.magic != magic || h.version != version ||
+           h.file_size != file_size || h.block_size == 0 ||
+           h.blocks != block_count(file_size, h.block_size) ||
+           h.path_size != output.size() ||
+           h.input_path_size != input.path.size() ||
+           h.input_inode != input.inode || h.input_mtime != input.mtime) {
+            continue;
+        }
+
+        std::string path(h.path_size, '\0');
+        std::string input_path(h.input_path_size, '\0');
+        std::vector<std::uint8_t> bitmap((h.blocks + 7) / 8);
+
+        // a journal being written by another writer may be incomplete, in
+        // which case it is ignored
+        if(!in.read(path.data(), static_cast<std::streamsize>(path.size())) ||
+           path != output ||
+           !in.read(input_path.data(),
+                    static_cast<std::streamsize>(input_path.size())) ||
+           input_path != input.path ||
+           !in.read(reinterpret_cast<char*>(bitmap.data()),
+                    static_cast<std::streamsize>(bitmap.size()))) {
+            continue;
+        }
+
+        auto& merged = result[h.block_size];
+        merged.resize(bitmap.size());
+
+        for(std::size_t i = 0; i < bitmap.size(); ++i) {
+            merged[i] |= bitmap[i];
+        }
+    }
+
+    return result;
+}
+
+} // namespace
+
+namespace posix_file {
+
+std::filesystem::path
+completion_journal::directory(const std::filesystem::path& dir,
+                              const std::filesystem::path& output) {
+
+    const auto& name = output.native();
+    std::array<char, 9> key;
+    std::snprintf(key.data(), key.size(), "%08x",
+                  crc32c(0, name.data(), name.size()));
+    return dir / key.data();
+}
+
+void
+completion_journal::remove(const std::filesystem::path& dir,
+                           const std::filesystem::path& output) noexcept {
+    std::error_code ec;
+    std::filesystem::remove_all(directory(dir, output), ec);
+}
+
+completion_journal::completion_journal(const std::filesystem::path& dir,
+                                       const std::filesystem::path& output,
+                                       const file& input,
+                                       std::size_t file_size,
+                                       std::size_t block_size, int id,
+                                       std::size_t interval)
+    : m_block_size(block_size), m_interval(std::max<std::size_t>(interval, 1)),
+      m_bitmap((block_count(file_size, block_size) + 7) / 8) {
+
+    const auto path = directory(dir, output);
+    const auto& name = output.native();
+    const auto blocks = block_count(file_size, block_size);
+    const auto id_input = identify(input);
+
+    std::filesystem::create_directories(path);
+
+    // a block was completed if all the blocks of a previous run that
+    // overlap it were completed
+    const auto previous =
+            id_input ? load(path, name, *id_input, file_size)
+                     : std::map<std::size_t, std::vector<std::uint8_t>>{};
+
+    for(std::size_t i = 0; i < blocks; ++i) {
+        const std::size_t begin = i * block_size;
+        const std::size_t end = std::min(begin + block_size, file_size);
+
+        for(const auto& [size, bitmap] : previous) {
+            std::size_t j = begin / size;
+            const std::size_t last = (end - 1) / size;
+
+            while(j <= last && test(bitmap, j)) {
+                ++j;
+            }
+
+            if(j > last) {
+                m_bitmap[i / 8] |= 1u << (i % 8);
+                ++m_resumed;
+                break;
+            }
+        }
+    }
+
+    // a journal of an unidentified input is never resumed: it records no
+    // inode nor modification time, which no input can match
+    const auto input_path = id_input ? id_input->path : std::string{};
+    const journal_header h{magic,
+                           version,
+                           static_cast<std::uint32_t>(name.size()),
+                           file_size,
+                           block_size,
+                           blocks,
+                           static_cast<std::uint32_t>(input_path.size()),
+                           0,
+                           id_input ? id_input->inode : 0,
+                           id_input ? id_input->mtime : 0};
+
+    const std::size_t header_size =
+            sizeof(h) + name.size() + input_path.size();
+
+    m_bitmap_offset = static_cast<offset>(header_size);
+
+    std::vector<std::uint8_t> data(header_size + m_bitmap.size());
+    std::memcpy(data.data(), &h, sizeof(h));
+    std::memcpy(data.data() + sizeof(h), name.data(), name.size());
+    std::memcpy(data.data() + sizeof(h) + name.size(), input_path.data(),
+                input_path.size());
+    std::copy(m_bitmap.begin(), m_bitmap.end(),
+              data.begin() + m_bitmap_offset);
+
+    // the journal is built aside and then renamed, so that other writers
+    // loading the directory see either the previous journal or this one
+    const auto tmp = path / (std::to_string(id) + ".tmp");
+
+    m_file = std::make_unique<file>(
+            open(tmp, O_CREAT | O_WRONLY | O_TRUNC, S_IRUSR | S_IWUSR,
+                 cargo::FSPlugin::type::posix));
+    m_file->pwrite(data, 0, data.size());
+
+    std::filesystem::rename(tmp, path / std::to_string(id));
+}
+
+bool
+completion_journal::completed(const ranges::range& r) const noexcept {
+    return test(m_bitmap, static_cast<std::size_t>(r.offset()) / m_block_size);
+}
+
+void
+completion_journal::complete(const ranges::range& r) {
+
+    const std::size_t i = static_cast<std::size_t>(r.offset()) / m_block_size;
+
+    if(test(m_bitmap, i)) {
+        return;
+    }
+
+    m_bitmap[i / 8] |= 1u << (i % 8);
+
+    if(m_pending == 0) {
+        m_dirty_begin = i / 8;
+        m_dirty_end = i / 8 + 1;
+    } else {
+        m_dirty_begin = std::min(m_dirty_begin, i / 8);
+        m_dirty_end = std::max(m_dirty_end, i / 8 + 1);
+    }
+
+    ++m_pending;
+}
+
+void
+completion_journal::flush(const file& output) {
+
+    if(m_pending == 0) {
+        return;
+    }
+
+    output.sync();
+
+    const std::span dirty{m_bitmap.data() + m_dirty_begin,
+                          m_dirty_end - m_dirty_begin};
+    m_file->pwrite(dirty, m_bitmap_offset + static_cast<offset>(m_dirty_begin),
+                   dirty.size());
+    m_pending = 0;
+}
+
+} // namespace posix_file
@@ -0,0 +1,143 @@
+/******************************************************************************
+ * Copyright 2022-2023, Barcelona Supercomputing Center (BSC), Spain
+ *
+ * This software was partially supported by the EuroHPC-funded project ADMIRE
+ *   (Project ID: 956748, https://www.admire-eurohpc.eu).
+ *
+ * This file is part of Cargo.
+ *
+ * Cargo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cargo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cargo.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *****************************************************************************/
+
+#ifndef POSIX_FILE_JOURNAL_HPP
+#define POSIX_FILE_JOURNAL_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <vector>
+#include "types.hpp"
+#include "ranges.hpp"
+#include "file.hpp"
+
+namespace posix_file {
+
+/**
+ * A crash-resistant record of the blocks of an output file that have been
+ * completely written.
+ *
+ * The journals of an output file live in their own directory, where each
+ * writer keeps a file with a bitmap of the blocks it has completed. The
+ * bitmap is kept in memory and written back in batches of `interval`
+ * blocks, right after flushing the data of the output file, so that the
+ * journal never records blocks that could still be lost.
+ *
+ * When a journal is opened, it merges the journals left in the directory by
+ * previous runs, even if they used a different block size or a different
+ * number of writers: a block is considered completed if all the bytes that
+ * it covers were completed by some previous writer. Journals of another
+ * input, or of the same input since modified or of a different size, are
+ * ignored. The directory must be removed once the whole file has been
+ * transferred, so that a later transfer of the same file does not skip any
+ * block.
+ *
+ * For instance, if a previous run completed the first 2 blocks of 512 bytes
+ * of a file of 3000 bytes:
+ *
+ * ```cpp
+ * completion_journal j{dir, "/out/file", input, 3000, 1024, 0};
+ * ```
+ *
+ * `j.completed({0, 1024})` is true, and `j.completed({1024, 1024})` is not.
+ */
+class completion_journal {
+
+public:
+    // Blocks completed between two writes of the journal
+    static constexpr std::size_t default_interval = 64;
+
+    // The directory under `dir` that holds the journals of `output`
+    static std::filesystem::path
+    directory(const std::filesystem::path& dir,
+              const std::filesystem::path& output);
+
+    // Remove the journals of `output` under `dir`, if any
+    static void
+    remove(const std::filesystem::path& dir,
+           const std::filesystem::path& output) noexcept;
+
+    /**
+     * Open journal `id` of `output` under `dir`, replacing any journal left
+     * there with the same `id`.
+     *
+     * @param dir The directory where the journals are kept.
+     * @param output The path of the output file.
+     * @param input The file whose data is transferred into `output`. Its
+     * path, inode and modification time identify the data journaled.
+     * @param file_size The size of the data transferred into `output`.
+     * @param block_size The size of the blocks recorded.
+     * @param id An identifier unique among the concurrent writers of
+     * `output`.
+     * @param interval The number of blocks completed between two writes.
+     */
+    completion_journal(const std::filesystem::path& dir,
+                       const std::filesystem::path& output, const file& input,
+                       std::size_t file_size, std::size_t block_size, int id,
+                       std::size_t interval = default_interval);
+
+    // Number of blocks completed by previous runs
+    std::size_t
+    resumed() const noexcept {
+        return m_resumed;
+    }
+
+    // Whether the block that starts at the offset of `r` is completed
+    bool
+    completed(const ranges::range& r) const noexcept;
+
+    // Record the block that starts at the offset of `r` as completed
+    void
+    complete(const ranges::range& r);
+
+    // Whether enough blocks have been completed to write the journal
+    bool
+    flush_due() const noexcept {
+        return m_pending >= m_interval;
+    }
+
+    // Flush the data written to `output` and then write the blocks completed
+    // since the last call. If the file system of `output` cannot flush its
+    // data, the blocks are only as durable as that file system makes them
+    void
+    flush(const file& output);
+
+private:
+    std::size_t m_block_size;
+    std::size_t m_interval;
+    std::size_t m_resumed = 0;
+    std::size_t m_pending = 0;
+    std::vector<std::uint8_t> m_bitmap;
+    // bytes of the bitmap modified since the last flush
+    std::size_t m_dirty_begin = 0;
+    std::size_t m_dirty_end = 0;
+    std::unique_ptr<file> m_file;
+    offset m_bitmap_offset = 0;
+};
+
+} // namespace posix_file
+
+#endif // POSIX_FILE_JOURNAL_HPP
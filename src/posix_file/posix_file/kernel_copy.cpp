@@ -0,0 +1,315 @@
+/******************************************************************************
+ * Copyright 2022-2023, Barcelona Supercomputing Center (BSC), Spain
+ *
+ * This software was partially supported by the EuroHPC-funded project ADMIRE
+ *   (Project ID: 956748, https://www.admire-eurohpc.eu).
+ *
+ * This file is part of Cargo.
+ *
+ * Cargo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cargo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cargo.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *****************************************************************************/
+
+
+#include "kernel_copy.hpp"
+
+#include <cerrno>
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+namespace posix_file {
+
+namespace {
+
+// `copy_with()` results other than the number of bytes copied
+// the method is not supported by these files: do not try it again
+constexpr std::int64_t unsupported = -1;
+// the method cannot be used for this range (e.g. because it is not aligned
+// to the filesystem block size), but may work for others
+constexpr std::int64_t unsuitable = -2;
+
+bool
+not_supported(int error) {
+    return error == EOPNOTSUPP || error == ENOTSUP || error == ENOTTY ||
+           error == ENOSYS || error == EXDEV || error == EINVAL ||
+           error == EBADF || error == EPERM;
+}
+
+/**
+ * A pipe used to splice data between two files. Each thread keeps its own.
+ */
+class splice_pipe {
+
+public:
+    splice_pipe() = default;
+
+    splice_pipe(const splice_pipe&) = delete;
+    splice_pipe&
+    operator=(const splice_pipe&) = delete;
+
+    ~splice_pipe() {
+        reset();
+    }
+
+    bool
+    open() {
+        if(m_fds[0] != -1) {
+            return true;
+        }
+
+        if(::pipe2(m_fds, O_CLOEXEC) == -1) {
+            return false;
+        }
+
+        // larger pipes need fewer splice() calls per block. This is only a
+        // hint, so errors are ignored
+        ::fcntl(m_fds[1], F_SETPIPE_SZ, 1024 * 1024);
+        m_capacity = static_cast<std::size_t>(::fcntl(m_fds[1], F_GETPIPE_SZ));
+        return true;
+    }
+
+    // Drop any data left in the pipe after a failed transfer
+    void
+    reset() noexcept {
+        for(int& fd : m_fds) {
+            if(fd != -1) {
+                ::close(fd);
+                fd = -1;
+            }
+        }
+    }
+
+    [[nodiscard]] int
+    read_end() const noexcept {
+        return m_fds[0];
+    }
+
+    [[nodiscard]] int
+    write_end() const noexcept {
+        return m_fds[1];
+    }
+
+    [[nodiscard]] std::size_t
+    capacity() const noexcept {
+        return m_capacity;
+    }
+
+private:
+    int m_fds[2] = {-1, -1};
+    std::size_t m_capacity = 0;
+};
+
+std::int64_t
+clone_range(int in, int out, offset offset, std::size_t size) {
+
+    file_clone_range args{};
+    args.src_fd = in;
+    args.src_offset = offset;
+    args.src_length = size;
+    args.dest_offset = offset;
+
+    if(::ioctl(out, FICLONERANGE, &args) == -1) {
+        if(errno == EINVAL) {
+            return unsuitable;
+        }
+        if(not_supported(errno)) {
+            return unsupported;
+        }
+        throw io_error("posix_file::kernel_copier::copy (FICLONERANGE)", errno);
+    }
+
+    return static_cast<std::int64_t>(size);
+}
+
+std::int64_t
+copy_range(int in, int out, offset offset, std::size_t size) {
+
+    auto off_in = static_cast<loff_t>(offset);
+    auto off_out = static_cast<loff_t>(offset);
+    std::size_t copied = 0;
+
+    while(copied < size) {
+        const ssize_t n = ::copy_file_range(in, &off_in, out, &off_out,
+                                            size - copied, 0);
+
+        if(n == 0) {
+            // EOF
+            break;
+        }
+
+        if(n == -1) {
+            if(errno == EINTR) {
+                continue;
+            }
+            // report the bytes already copied and let the caller retry the
+            // remaining ones, which reports the error again if it persists
+            if(copied != 0) {
+                break;
+            }
+            if(not_supported(errno)) {
+                return unsupported;
+            }
+            throw io_error("posix_file::kernel_copier::copy (copy_file_range)",
+                           errno);
+        }
+
+        copied += n;
+    }
+
+    return static_cast<std::int64_t>(copied);
+}
+
+std::int64_t
+splice_range(int in, int out, offset offset, std::size_t size) {
+
+    thread_local splice_pipe pipe;
+
+    if(!pipe.open()) {
+        return unsupported;
+    }
+
+    auto off_in = static_cast<loff_t>(offset);
+    auto off_out = static_cast<loff_t>(offset);
+    std::size_t copied = 0;
+
+    while(copied < size) {
+        ssize_t n = ::splice(in, &off_in, pipe.write_end(), nullptr,
+                             std::min(size - copied, pipe.capacity()),
+                             SPLICE_F_MOVE);
+
+        if(n == 0) {
+            // EOF
+            break;
+        }
+
+        if(n == -1) {
+            if(errno == EINTR) {
+                continue;
+            }
+            if(copied == 0 && not_supported(errno)) {
+                return unsupported;
+            }
+            throw io_error("posix_file::kernel_copier::copy (splice)", errno);
+        }
+
+        // drain the pipe into the output file
+        for(auto left = static_cast<std::size_t>(n); left != 0;) {
+            const ssize_t m = ::splice(pipe.read_end(), nullptr, out, &off_out,
+                                       left, SPLICE_F_MOVE);
+
+            if(m == -1) {
+                if(errno == EINTR) {
+                    continue;
+                }
+
+                const int error = errno;
+                pipe.reset();
+
+                if(copied == 0 && not_supported(error)) {
+                    return unsupported;
+                }
+                throw io_error("posix_file::kernel_copier::copy (splice)",
+                               error);
+            }
+
+            left -= m;
+        }
+
+        copied += n;
+    }
+
+    return static_cast<std::int64_t>(copied);
+}
+
+} // namespace
+
+bool
+kernel_copier::supported(const file& in, const file& out) noexcept {
+    return in.native_handle() != -1 && out.native_handle() != -1;
+}
+
+kernel_copier::method
+kernel_copier::current() const noexcept {
+    return m_method.load(std::memory_order_relaxed);
+}
+
+void
+kernel_copier::disable(method m) noexcept {
+    // move to the next method unless another thread already did
+    auto expected = m;
+    m_method.compare_exchange_strong(
+            expected, static_cast<method>(static_cast<int>(m) + 1),
+            std::memory_order_relaxed);
+}
+
+std::int64_t
+kernel_copier::copy_with(method m, int in, int out, offset offset,
+                         std::size_t size) {
+    switch(m) {
+        case method::clone:
+            return clone_range(in, out, offset, size);
+        case method::copy_file_range:
+            return copy_range(in, out, offset, size);
+        case method::splice:
+            return splice_range(in, out, offset, size);
+        case method::none:
+            break;
+    }
+    return unsupported;
+}
+
+std::size_t
+kernel_copier::copy(const file& in, const file& out, std::span<char> buf,
+                    offset offset, std::size_t size) {
+
+    std::size_t copied = 0;
+    auto m = supported(in, out) ? current() : method::none;
+
+    while(copied < size && m != method::none) {
+
+        const auto n = copy_with(m, in.native_handle(), out.native_handle(),
+                                 offset + copied, size - copied);
+
+        if(n == unsupported) {
+            disable(m);
+        }
+
+        if(n < 0) {
+            // try the next method for this range
+            m = static_cast<method>(static_cast<int>(m) + 1);
+            continue;
+        }
+
+        if(n == 0) {
+            // EOF
+            return copied;
+        }
+
+        copied += n;
+    }
+
+    if(copied == size) {
+        return copied;
+    }
+
+    // the kernel cannot copy these files, go through user space
+    const std::size_t n = in.pread(buf, offset + copied, size - copied);
+    out.pwrite(buf, offset + copied, n);
+    return copied + n;
+}
+
+} // namespace posix_file
@@ -0,0 +1,100 @@
+/******************************************************************************
+ * Copyright 2022-2023, Barcelona Supercomputing Center (BSC), Spain
+ *
+ * This software was partially supported by the EuroHPC-funded project ADMIRE
+ *   (Project ID: 956748, https://www.admire-eurohpc.eu).
+ *
+ * This file is part of Cargo.
+ *
+ * Cargo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cargo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cargo.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *****************************************************************************/
+
+
+#ifndef POSIX_FILE_KERNEL_COPY_HPP
+#define POSIX_FILE_KERNEL_COPY_HPP
+
+#include <atomic>
+#include <span>
+#include "file.hpp"
+
+namespace posix_file {
+
+/**
+ * Copies byte ranges between two files without moving the data through user
+ * space, trying in order:
+ *
+ *  1. `ioctl(FICLONERANGE)`, which shares the extents of the source file with
+ *     the destination file (reflink) on filesystems that support it (e.g.
+ *     XFS or Btrfs), so no data is copied at all.
+ *  2. `copy_file_range(2)`, which lets the kernel (or the filesystem) copy
+ *     the data directly between the page caches.
+ *  3. `splice(2)` through a pipe, which still avoids the copies to and from
+ *     user space.
+ *
+ * Methods that fail because the files or the filesystem do not support them
+ * are not tried again by the same copier. If none of them works, data is
+ * copied with `pread()`/`pwrite()` through a buffer provided by the caller.
+ *
+ * A copier can be shared by several threads copying ranges of the same
+ * files concurrently.
+ */
+class kernel_copier {
+
+public:
+    enum class method { clone, copy_file_range, splice, none };
+
+    /**
+     * @brief Checks whether the kernel can copy data between `in` and `out`.
+     * @return true if both files are backed by kernel file descriptors
+     */
+    [[nodiscard]] static bool
+    supported(const file& in, const file& out) noexcept;
+
+    /**
+     * @brief Returns the most efficient method that has not failed so far.
+     */
+    [[nodiscard]] method
+    current() const noexcept;
+
+    /**
+     * @brief Copy `size` bytes at `offset` from `in` into the same offset of
+     * `out`.
+     * @param buf A staging buffer of at least `size` bytes, only used if the
+     * kernel cannot copy the data by itself.
+     * @return the number of bytes copied, which is less than `size` only if
+     * the source file ends before `offset + size`.
+     * @throws io_error if the copy fails
+     */
+    std::size_t
+    copy(const file& in, const file& out, std::span<char> buf, offset offset,
+         std::size_t size);
+
+private:
+    // Try to copy [offset, offset + size) with `m`. Returns the number of
+    // bytes copied, or one of the negative values below if `m` cannot be
+    // used (see kernel_copy.cpp)
+    static std::int64_t
+    copy_with(method m, int in, int out, offset offset, std::size_t size);
+
+    void
+    disable(method m) noexcept;
+
+    std::atomic<method> m_method{method::clone};
+};
+
+} // namespace posix_file
+
+#endif // POSIX_FILE_KERNEL_COPY_HPP
@@ -26,11 +26,17 @@
 #define CARGO_PROTO_MPI_MESSAGE_HPP
 
 #include <fmt/format.h>
+#include <fmt/ranges.h>
 #include <filesystem>
 #include <boost/archive/binary_oarchive.hpp>
+#include <boost/serialization/string.hpp>
+#include <boost/serialization/utility.hpp>
+#include <boost/serialization/vector.hpp>
 #include <utility>
 #include <optional>
+#include <vector>
 #include "cargo.hpp"
+#include "fmt_formatters.hpp"
 #include "boost_serialization_std_optional.hpp"
 #include "posix_file/file.hpp"
 
@@ -41,8 +47,15 @@ enum class tag : int {
     pwrite,
     sequential,
     seq_mixed,
+    transfer_list,
+    batch,
     bw_shaping,
+    bw_limit,
     status,
+    batch_status,
+    status_report,
+    claim,
+    grant,
     shutdown
 };
 
@@ -55,10 +68,14 @@ public:
 
     transfer_message(std::uint64_t tid, std::uint32_t seqno,
                      std::string input_path, std::uint32_t i_type,
-                     std::string output_path, std::uint32_t o_type)
+                     std::string output_path, std::uint32_t o_type,
+                     std::uint64_t block_size = 0,
+                     std::uint64_t chunk_blocks = 0,
+                     cargo::mpio_hints hints = {})
         : m_tid(tid), m_seqno(seqno), m_input_path(std::move(input_path)),
           m_i_type(i_type), m_output_path(std::move(output_path)),
-          m_o_type(o_type) {}
+          m_o_type(o_type), m_block_size(block_size),
+          m_chunk_blocks(chunk_blocks), m_hints(std::move(hints)) {}
 
     [[nodiscard]] std::uint64_t
     tid() const {
@@ -91,6 +108,27 @@ public:
         return static_cast<cargo::FSPlugin::type>(m_i_type);
     }
 
+    /* Block size (in KiB) chosen for this file, or 0 to use the worker's
+     * default */
+    [[nodiscard]] std::uint64_t
+    block_size() const {
+        return m_block_size;
+    }
+
+    /* Number of blocks that workers claim at once from the master, or 0 if
+     * the blocks of the file are assigned statically */
+    [[nodiscard]] std::uint64_t
+    chunk_blocks() const {
+        return m_chunk_blocks;
+    }
+
+    /* MPI-IO hints requested for this transfer, if the file is transferred
+     * collectively */
+    [[nodiscard]] const cargo::mpio_hints&
+    hints() const {
+        return m_hints;
+    }
+
 private:
     template <class Archive>
     void
@@ -103,6 +141,9 @@ private:
         ar& m_output_path;
         ar& m_i_type;
         ar& m_o_type;
+        ar& m_block_size;
+        ar& m_chunk_blocks;
+        ar& m_hints;
     }
 
     std::uint64_t m_tid{};
@@ -111,6 +152,143 @@ private:
     std::uint32_t m_i_type{};
     std::string m_output_path;
     std::uint32_t m_o_type{};
+    std::uint64_t m_block_size{};
+    std::uint64_t m_chunk_blocks{};
+    cargo::mpio_hints m_hints;
+};
+
+// The transfers of several files that every worker takes part in, sent at
+// once instead of one message per file. Each transfer keeps the tag that it
+// would have been sent with
+class transfer_list_message {
+
+    friend class boost::serialization::access;
+
+public:
+    transfer_list_message() = default;
+
+    void
+    add(cargo::tag t, transfer_message m) {
+        m_tags.push_back(static_cast<int>(t));
+        m_transfers.push_back(std::move(m));
+    }
+
+    [[nodiscard]] std::size_t
+    size() const {
+        return m_transfers.size();
+    }
+
+    [[nodiscard]] cargo::tag
+    tag_of(std::size_t i) const {
+        return static_cast<cargo::tag>(m_tags[i]);
+    }
+
+    [[nodiscard]] const std::vector<transfer_message>&
+    transfers() const {
+        return m_transfers;
+    }
+
+private:
+    template <class Archive>
+    void
+    serialize(Archive& ar, const unsigned int version) {
+        (void) version;
+
+        ar& m_tags;
+        ar& m_transfers;
+    }
+
+    std::vector<int> m_tags;
+    std::vector<transfer_message> m_transfers;
+};
+
+// A list of (small) files of the same transfer that are transferred back to
+// back by a single worker
+class batch_message {
+
+    friend class boost::serialization::access;
+
+public:
+    batch_message() = default;
+
+    batch_message(std::uint64_t tid, std::uint32_t i_type, std::uint32_t o_type,
+                  std::uint64_t block_size = 0)
+        : m_tid(tid), m_i_type(i_type), m_o_type(o_type),
+          m_block_size(block_size) {}
+
+    void
+    add(std::uint32_t seqno, std::string input_path, std::string output_path) {
+        m_seqnos.push_back(seqno);
+        m_input_paths.push_back(std::move(input_path));
+        m_output_paths.push_back(std::move(output_path));
+    }
+
+    [[nodiscard]] std::uint64_t
+    tid() const {
+        return m_tid;
+    }
+
+    [[nodiscard]] std::size_t
+    size() const {
+        return m_seqnos.size();
+    }
+
+    [[nodiscard]] const std::vector<std::uint32_t>&
+    seqnos() const {
+        return m_seqnos;
+    }
+
+    [[nodiscard]] const std::vector<std::string>&
+    input_paths() const {
+        return m_input_paths;
+    }
+
+    [[nodiscard]] const std::vector<std::string>&
+    output_paths() const {
+        return m_output_paths;
+    }
+
+    /* Enum is converted from cargo::dataset::type to cargo::FSPlugin::type */
+    [[nodiscard]] cargo::FSPlugin::type
+    i_type() const {
+        return static_cast<cargo::FSPlugin::type>(m_i_type);
+    }
+
+    /* Enum is converted from cargo::dataset::type to cargo::FSPlugin::type */
+    [[nodiscard]] cargo::FSPlugin::type
+    o_type() const {
+        return static_cast<cargo::FSPlugin::type>(m_o_type);
+    }
+
+    /* Block size (in KiB) for the files of the batch, or 0 to use the
+     * worker's default */
+    [[nodiscard]] std::uint64_t
+    block_size() const {
+        return m_block_size;
+    }
+
+private:
+    template <class Archive>
+    void
+    serialize(Archive& ar, const unsigned int version) {
+        (void) version;
+
+        ar& m_tid;
+        ar& m_seqnos;
+        ar& m_input_paths;
+        ar& m_output_paths;
+        ar& m_i_type;
+        ar& m_o_type;
+        ar& m_block_size;
+    }
+
+    std::uint64_t m_tid{};
+    std::vector<std::uint32_t> m_seqnos;
+    std::vector<std::string> m_input_paths;
+    std::vector<std::string> m_output_paths;
+    std::uint32_t m_i_type{};
+    std::uint32_t m_o_type{};
+    std::uint64_t m_block_size{};
 };
 
 class status_message {
@@ -122,9 +300,11 @@ public:
 
     status_message(std::uint64_t tid, std::uint32_t seqno, std::string name, 
                    cargo::transfer_state state, float bw,
-                   std::optional<cargo::error_code> error_code = std::nullopt)
+                   std::optional<cargo::error_code> error_code = std::nullopt,
+                   std::optional<std::uint32_t> checksum = std::nullopt,
+                   std::uint32_t parts = 1)
         : m_tid(tid), m_seqno(seqno), m_name(name), m_state(state), m_bw(bw),
-          m_error_code(error_code) {}
+          m_error_code(error_code), m_checksum(checksum), m_parts(parts) {}
 
     [[nodiscard]] std::uint64_t
     tid() const {
@@ -157,6 +337,21 @@ public:
         return m_error_code;
     }
 
+    // The digest of the part of the file transferred by the worker, if it
+    // has completed and checksums are enabled
+    [[nodiscard]] std::optional<std::uint32_t>
+    checksum() const {
+        return m_checksum;
+    }
+
+    // Number of workers whose parts of the file are summarized by this
+    // update. If it is more than one, the bandwidth is the sum of theirs
+    // and the digest covers all their parts
+    [[nodiscard]] std::uint32_t
+    parts() const {
+        return m_parts;
+    }
+
 private:
     template <class Archive>
     void
@@ -169,6 +364,8 @@ private:
         ar& m_state;
         ar& m_bw;
         ar& m_error_code;
+        ar& m_checksum;
+        ar& m_parts;
     }
 
     std::uint64_t m_tid{};
@@ -177,6 +374,224 @@ private:
     cargo::transfer_state m_state{};
     float m_bw{};
     std::optional<cargo::error_code> m_error_code{};
+    std::optional<std::uint32_t> m_checksum{};
+    std::uint32_t m_parts{1};
+};
+
+// The states of the files that a worker is transferring, coalesced since its
+// last report
+class status_report_message {
+
+    friend class boost::serialization::access;
+
+public:
+    status_report_message() = default;
+
+    void
+    add(status_message m) {
+        m_updates.push_back(std::move(m));
+    }
+
+    [[nodiscard]] std::size_t
+    size() const {
+        return m_updates.size();
+    }
+
+    [[nodiscard]] const std::vector<status_message>&
+    updates() const {
+        return m_updates;
+    }
+
+    [[nodiscard]] std::vector<status_message>&
+    updates() {
+        return m_updates;
+    }
+
+private:
+    template <class Archive>
+    void
+    serialize(Archive& ar, const unsigned int version) {
+        (void) version;
+
+        ar& m_updates;
+    }
+
+    std::vector<status_message> m_updates;
+};
+
+// The state of several files of a transfer, each of them transferred by a
+// single worker on behalf of all the others
+class batch_status_message {
+
+    friend class boost::serialization::access;
+
+public:
+    batch_status_message() = default;
+
+    batch_status_message(std::uint64_t tid, cargo::transfer_state state,
+                         float bw,
+                         std::optional<cargo::error_code> error_code =
+                                 std::nullopt)
+        : m_tid(tid), m_state(state), m_bw(bw), m_error_code(error_code) {}
+
+    void
+    add(std::uint32_t seqno, std::string name,
+        std::optional<std::uint32_t> checksum = std::nullopt) {
+        m_seqnos.push_back(seqno);
+        m_names.push_back(std::move(name));
+        m_checksums.push_back(checksum);
+    }
+
+    [[nodiscard]] std::uint64_t
+    tid() const {
+        return m_tid;
+    }
+
+    [[nodiscard]] std::size_t
+    size() const {
+        return m_seqnos.size();
+    }
+
+    [[nodiscard]] const std::vector<std::uint32_t>&
+    seqnos() const {
+        return m_seqnos;
+    }
+
+    [[nodiscard]] const std::vector<std::string>&
+    names() const {
+        return m_names;
+    }
+
+    // The digest of each file, if checksums are enabled
+    [[nodiscard]] const std::vector<std::optional<std::uint32_t>>&
+    checksums() const {
+        return m_checksums;
+    }
+
+    [[nodiscard]] cargo::transfer_state
+    state() const {
+        return m_state;
+    }
+
+    [[nodiscard]] float
+    bw() const {
+        return m_bw;
+    }
+
+    [[nodiscard]] std::optional<cargo::error_code>
+    error_code() const {
+        return m_error_code;
+    }
+
+private:
+    template <class Archive>
+    void
+    serialize(Archive& ar, const unsigned int version) {
+        (void) version;
+
+        ar& m_tid;
+        ar& m_seqnos;
+        ar& m_names;
+        ar& m_checksums;
+        ar& m_state;
+        ar& m_bw;
+        ar& m_error_code;
+    }
+
+    std::uint64_t m_tid{};
+    std::vector<std::uint32_t> m_seqnos;
+    std::vector<std::string> m_names;
+    std::vector<std::optional<std::uint32_t>> m_checksums;
+    cargo::transfer_state m_state{};
+    float m_bw{};
+    std::optional<cargo::error_code> m_error_code{};
+};
+
+// A request from a worker for more blocks of a file
+class claim_message {
+
+    friend class boost::serialization::access;
+
+public:
+    claim_message() = default;
+
+    claim_message(std::uint64_t tid, std::uint32_t seqno)
+        : m_tid(tid), m_seqno(seqno) {}
+
+    [[nodiscard]] std::uint64_t
+    tid() const {
+        return m_tid;
+    }
+
+    [[nodiscard]] std::uint32_t
+    seqno() const {
+        return m_seqno;
+    }
+
+private:
+    template <class Archive>
+    void
+    serialize(Archive& ar, const unsigned int version) {
+        (void) version;
+
+        ar& m_tid;
+        ar& m_seqno;
+    }
+
+    std::uint64_t m_tid{};
+    std::uint32_t m_seqno{};
+};
+
+// The blocks of a file handed out to a worker in response to a claim
+class grant_message {
+
+    friend class boost::serialization::access;
+
+public:
+    grant_message() = default;
+
+    grant_message(std::uint64_t tid, std::uint32_t seqno,
+                  std::uint64_t first_block, std::uint64_t count)
+        : m_tid(tid), m_seqno(seqno), m_first_block(first_block),
+          m_count(count) {}
+
+    [[nodiscard]] std::uint64_t
+    tid() const {
+        return m_tid;
+    }
+
+    [[nodiscard]] std::uint32_t
+    seqno() const {
+        return m_seqno;
+    }
+
+    [[nodiscard]] std::uint64_t
+    first_block() const {
+        return m_first_block;
+    }
+
+    // 0 means that the file has no blocks left
+    [[nodiscard]] std::uint64_t
+    count() const {
+        return m_count;
+    }
+
+private:
+    template <class Archive>
+    void
+    serialize(Archive& ar, const unsigned int version) {
+        (void) version;
+
+        ar& m_tid;
+        ar& m_seqno;
+        ar& m_first_block;
+        ar& m_count;
+    }
+
+    std::uint64_t m_tid{};
+    std::uint32_t m_seqno{};
+    std::uint64_t m_first_block{};
+    std::uint64_t m_count{};
 };
 
 class shaper_message {
@@ -214,6 +629,41 @@ private:
 };
 
 
+class bw_limit_message {
+
+    friend class boost::serialization::access;
+
+public:
+    bw_limit_message() = default;
+
+    bw_limit_message(std::uint64_t tid, std::uint64_t bytes_per_second)
+        : m_tid(tid), m_bytes_per_second(bytes_per_second) {}
+
+    [[nodiscard]] std::uint64_t
+    tid() const {
+        return m_tid;
+    }
+
+    // 0 means no limit
+    [[nodiscard]] std::uint64_t
+    bytes_per_second() const {
+        return m_bytes_per_second;
+    }
+
+private:
+    template <class Archive>
+    void
+    serialize(Archive& ar, const unsigned int version) {
+        (void) version;
+
+        ar& m_tid;
+        ar& m_bytes_per_second;
+    }
+
+    std::uint64_t m_tid{};
+    std::uint64_t m_bytes_per_second{};
+};
+
 class shutdown_message {
 
     friend class boost::serialization::access;
@@ -238,8 +688,10 @@ struct fmt::formatter<cargo::transfer_message> : formatter<std::string_view> {
     auto
     format(const cargo::transfer_message& r, FormatContext& ctx) const {
         const auto str = fmt::format(
-                "{{tid: {}, seqno: {}, input_path: {}, output_path: {}}}",
-                r.tid(), r.seqno(), r.input_path(), r.output_path());
+                "{{tid: {}, seqno: {}, input_path: {}, output_path: {}, "
+                "block_size: {}, chunk_blocks: {}, hints: {}}}",
+                r.tid(), r.seqno(), r.input_path(), r.output_path(),
+                r.block_size(), r.chunk_blocks(), r.hints());
         return formatter<std::string_view>::format(str, ctx);
     }
 };
@@ -250,7 +702,7 @@ struct fmt::formatter<cargo::status_message> : formatter<std::string_view> {
     template <typename FormatContext>
     auto
     format(const cargo::status_message& s, FormatContext& ctx) const {
-        const auto str =
+        auto str =
                 s.error_code()
                         ? fmt::format(
                                   "{{tid: {}, seqno: {}, name: {}, state: {}, bw: {}, "
@@ -260,6 +712,97 @@ struct fmt::formatter<cargo::status_message> : formatter<std::string_view> {
                         : fmt::format(
                                   "{{tid: {}, seqno: {}, name: {}, state: {}, bw: {}}}",
                                   s.tid(), s.seqno(), s.name(), s.state(), s.bw());
+        if(s.checksum()) {
+            str.insert(str.size() - 1,
+                       fmt::format(", checksum: {:08x}", *s.checksum()));
+        }
+        if(s.parts() != 1) {
+            str.insert(str.size() - 1, fmt::format(", parts: {}", s.parts()));
+        }
+        return formatter<std::string_view>::format(str, ctx);
+    }
+};
+
+template <>
+struct fmt::formatter<cargo::transfer_list_message>
+    : formatter<std::string_view> {
+    // parse is inherited from formatter<string_view>.
+    template <typename FormatContext>
+    auto
+    format(const cargo::transfer_list_message& l, FormatContext& ctx) const {
+        const auto str = fmt::format("{{transfers: {}}}", l.size());
+        return formatter<std::string_view>::format(str, ctx);
+    }
+};
+
+template <>
+struct fmt::formatter<cargo::batch_message> : formatter<std::string_view> {
+    // parse is inherited from formatter<string_view>.
+    template <typename FormatContext>
+    auto
+    format(const cargo::batch_message& m, FormatContext& ctx) const {
+        const auto str = fmt::format(
+                "{{tid: {}, seqnos: [{}], block_size: {}}}", m.tid(),
+                fmt::join(m.seqnos(), ", "), m.block_size());
+        return formatter<std::string_view>::format(str, ctx);
+    }
+};
+
+template <>
+struct fmt::formatter<cargo::batch_status_message>
+    : formatter<std::string_view> {
+    // parse is inherited from formatter<string_view>.
+    template <typename FormatContext>
+    auto
+    format(const cargo::batch_status_message& s, FormatContext& ctx) const {
+        const auto str =
+                s.error_code()
+                        ? fmt::format("{{tid: {}, seqnos: [{}], state: {}, "
+                                      "bw: {}, error_code: {}}}",
+                                      s.tid(), fmt::join(s.seqnos(), ", "),
+                                      s.state(), s.bw(), *s.error_code())
+                        : fmt::format("{{tid: {}, seqnos: [{}], state: {}, "
+                                      "bw: {}}}",
+                                      s.tid(), fmt::join(s.seqnos(), ", "),
+                                      s.state(), s.bw());
+        return formatter<std::string_view>::format(str, ctx);
+    }
+};
+
+template <>
+struct fmt::formatter<cargo::status_report_message>
+    : formatter<std::string_view> {
+    // parse is inherited from formatter<string_view>.
+    template <typename FormatContext>
+    auto
+    format(const cargo::status_report_message& r, FormatContext& ctx) const {
+        const auto str = fmt::format("{{updates: [{}]}}",
+                                     fmt::join(r.updates(), ", "));
+        return formatter<std::string_view>::format(str, ctx);
+    }
+};
+
+template <>
+struct fmt::formatter<cargo::claim_message> : formatter<std::string_view> {
+    // parse is inherited from formatter<string_view>.
+    template <typename FormatContext>
+    auto
+    format(const cargo::claim_message& m, FormatContext& ctx) const {
+        const auto str =
+                fmt::format("{{tid: {}, seqno: {}}}", m.tid(), m.seqno());
+        return formatter<std::string_view>::format(str, ctx);
+    }
+};
+
+template <>
+struct fmt::formatter<cargo::grant_message> : formatter<std::string_view> {
+    // parse is inherited from formatter<string_view>.
+    template <typename FormatContext>
+    auto
+    format(const cargo::grant_message& m, FormatContext& ctx) const {
+        const auto str = fmt::format(
+                "{{tid: {}, seqno: {}, first_block: {}, count: {}}}", m.tid(),
+                m.seqno(), m.first_block(), m.count());
         return formatter<std::string_view>::format(str, ctx);
     }
 };
@@ -276,6 +819,18 @@ struct fmt::formatter<cargo::shaper_message> : formatter<std::string_view> {
     }
 };
 
+template <>
+struct fmt::formatter<cargo::bw_limit_message> : formatter<std::string_view> {
+    // parse is inherited from formatter<string_view>.
+    template <typename FormatContext>
+    auto
+    format(const cargo::bw_limit_message& m, FormatContext& ctx) const {
+        const auto str = fmt::format("{{tid: {}, bytes_per_second: {}}}",
+                                     m.tid(), m.bytes_per_second());
+        return formatter<std::string_view>::format(str, ctx);
+    }
+};
+
 
 template <>
 struct fmt::formatter<cargo::shutdown_message> : formatter<std::string_view> {
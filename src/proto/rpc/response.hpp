@@ -109,9 +109,13 @@ using status_response =
         response_with_value<std::tuple<Status, Bw, std::optional<Error>>,
                             Error>;
 
+// The status of each file of a transfer, along with its CRC32C digest if it
+// has completed and it was verified
 template <typename Name, typename Status, typename Bw, typename Error>
 using statuses_response = response_with_value<
-        std::vector<std::tuple<Name, Status, Bw, std::optional<Error>>>, Error>;
+        std::vector<std::tuple<Name, Status, Bw, std::optional<Error>,
+                               std::optional<std::uint32_t>>>,
+        Error>;
 
 } // namespace cargo::proto
 
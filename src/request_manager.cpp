@@ -27,10 +27,33 @@
 #include "parallel_request.hpp"
 #include "request_manager.hpp"
 
+#include <algorithm>
 #include <utility>
 #include "logger/logger.hpp"
 
-namespace {} // namespace
+namespace {
+
+// The digest of a whole file is the XOR of the digests of its parts, but it
+// is only known once all of them have been transferred
+std::optional<std::uint32_t>
+file_checksum(const std::vector<cargo::part_status>& parts) {
+
+    std::optional<std::uint32_t> result;
+
+    for(const auto& ps : parts) {
+        if(ps.state() != cargo::transfer_state::completed) {
+            return std::nullopt;
+        }
+
+        if(ps.checksum()) {
+            result = result.value_or(0) ^ *ps.checksum();
+        }
+    }
+
+    return result;
+}
+
+} // namespace
 
 namespace cargo {
 
@@ -69,6 +92,8 @@ request_manager::update(std::uint64_t tid, std::size_t nfiles,
     abt::unique_lock lock(m_mutex);
     m_requests[tid] = std::vector<file_status>{nfiles,
                                           std::vector<part_status>{nworkers}};
+    // the files are dispatched again
+    m_workers.erase(tid);
 
     return error_code::success;
 
@@ -76,17 +101,60 @@ request_manager::update(std::uint64_t tid, std::size_t nfiles,
 }
 
 
+error_code
+request_manager::set_workers(std::uint64_t tid, std::uint32_t seqno,
+                             std::size_t nworkers) {
+
+    abt::unique_lock lock(m_mutex);
+
+    if(const auto it = m_requests.find(tid); it != m_requests.end()) {
+        assert(seqno < it->second.size());
+        it->second[seqno].assign(nworkers, part_status{});
+        return error_code::success;
+    }
+
+    LOGGER_ERROR("{}: Request {} not found", __FUNCTION__, tid);
+    return error_code::no_such_transfer;
+}
+
+error_code
+request_manager::add_worker(std::uint64_t tid, std::size_t wid) {
+
+    abt::unique_lock lock(m_mutex);
+
+    if(m_requests.contains(tid)) {
+        m_workers[tid].insert(wid);
+        return error_code::success;
+    }
+
+    LOGGER_ERROR("{}: Request {} not found", __FUNCTION__, tid);
+    return error_code::no_such_transfer;
+}
+
+std::set<std::size_t>
+request_manager::workers(std::uint64_t tid) {
+
+    abt::shared_lock lock(m_mutex);
+
+    if(const auto it = m_workers.find(tid); it != m_workers.end()) {
+        return it->second;
+    }
+
+    return {};
+}
+
 error_code
 request_manager::update(std::uint64_t tid, std::uint32_t seqno, std::size_t wid,
                         std::string name, transfer_state s, float bw,
-                        std::optional<error_code> ec) {
+                        std::optional<error_code> ec,
+                        std::optional<std::uint32_t> checksum) {
 
     abt::unique_lock lock(m_mutex);
 
     if(const auto it = m_requests.find(tid); it != m_requests.end()) {
         assert(seqno < it->second.size());
         assert(wid < it->second[seqno].size());
-        it->second[seqno][wid].update(name, s, bw, ec);
+        it->second[seqno][wid].update(name, s, bw, ec, checksum);
         return error_code::success;
     }
 
@@ -94,6 +162,60 @@ request_manager::update(std::uint64_t tid, std::uint32_t seqno, std::size_t wid,
     return error_code::no_such_transfer;
 }
 
+error_code
+request_manager::update(std::uint64_t tid, std::uint32_t seqno,
+                        std::string name, transfer_state s, float bw,
+                        std::optional<error_code> ec,
+                        std::optional<std::uint32_t> checksum) {
+
+    abt::unique_lock lock(m_mutex);
+
+    if(const auto it = m_requests.find(tid); it != m_requests.end()) {
+        assert(seqno < it->second.size());
+        for(auto& ps : it->second[seqno]) {
+            // the digest covers the whole file, so it must only be
+            // accounted for once
+            ps.update(name, s, bw, ec, checksum);
+            checksum.reset();
+        }
+        return error_code::success;
+    }
+
+    LOGGER_ERROR("{}: Request {} not found", __FUNCTION__, tid);
+    return error_code::no_such_transfer;
+}
+
+std::optional<std::uint32_t>
+request_manager::checksum(std::uint64_t tid, std::uint32_t seqno) {
+
+    abt::shared_lock lock(m_mutex);
+
+    if(const auto it = m_requests.find(tid); it != m_requests.end()) {
+        assert(seqno < it->second.size());
+        return file_checksum(it->second[seqno]);
+    }
+
+    LOGGER_ERROR("{}: Request {} not found", __FUNCTION__, tid);
+    return std::nullopt;
+}
+
+bool
+request_manager::completed(std::uint64_t tid, std::uint32_t seqno) {
+
+    abt::shared_lock lock(m_mutex);
+
+    if(const auto it = m_requests.find(tid); it != m_requests.end()) {
+        assert(seqno < it->second.size());
+        return std::all_of(it->second[seqno].begin(), it->second[seqno].end(),
+                           [](const part_status& ps) {
+                               return ps.state() == transfer_state::completed;
+                           });
+    }
+
+    LOGGER_ERROR("{}: Request {} not found", __FUNCTION__, tid);
+    return false;
+}
+
 tl::expected<request_status, error_code>
 request_manager::lookup(std::uint64_t tid) {
 
@@ -143,6 +265,7 @@ request_manager::lookup_all(std::uint64_t tid) {
                 rs = request_status{ps};
             }
             rs.bw(bw / (double) fs.size());
+            rs.checksum(file_checksum(fs));
             result.push_back(rs);
         }
         return result;
@@ -159,6 +282,7 @@ request_manager::remove(std::uint64_t tid) {
 
     if(const auto it = m_requests.find(tid); it != m_requests.end()) {
         m_requests.erase(it);
+        m_workers.erase(tid);
         return error_code::success;
     }
 
@@ -27,6 +27,7 @@
 
 #include <tl/expected.hpp>
 #include <atomic>
+#include <set>
 #include "parallel_request.hpp"
 #include "shared_mutex.hpp"
 
@@ -61,10 +62,42 @@ public:
     error_code
     update(std::uint64_t tid, std::size_t nfiles, std::size_t nworkers);
 
+    // File `seqno` is transferred by `nworkers` workers rather than by all
+    // the workers of the request
+    error_code
+    set_workers(std::uint64_t tid, std::uint32_t seqno, std::size_t nworkers);
+
+    // Worker `wid` has been sent parts of transfer `tid`
+    error_code
+    add_worker(std::uint64_t tid, std::size_t wid);
+
+    // The workers that have been sent parts of transfer `tid`
+    std::set<std::size_t>
+    workers(std::uint64_t tid);
+
     error_code
     update(std::uint64_t tid, std::uint32_t seqno, std::size_t wid,
            std::string name, transfer_state s, float bw,
-           std::optional<error_code> ec = std::nullopt);
+           std::optional<error_code> ec = std::nullopt,
+           std::optional<std::uint32_t> checksum = std::nullopt);
+
+    // Update the status of file `seqno` for all its workers, when the file
+    // is transferred by a single worker on behalf of the others, or when the
+    // workers have reduced their updates to a single one
+    error_code
+    update(std::uint64_t tid, std::uint32_t seqno, std::string name,
+           transfer_state s, float bw,
+           std::optional<error_code> ec = std::nullopt,
+           std::optional<std::uint32_t> checksum = std::nullopt);
+
+    // The digest of file `seqno`, once all its workers have completed and
+    // reported the digests of their parts
+    std::optional<std::uint32_t>
+    checksum(std::uint64_t tid, std::uint32_t seqno);
+
+    // Whether all the workers of file `seqno` have completed
+    bool
+    completed(std::uint64_t tid, std::uint32_t seqno);
 
     tl::expected<request_status, error_code>
     lookup(std::uint64_t tid);
@@ -79,6 +112,7 @@ private:
     std::atomic<std::uint64_t> current_tid = 0;
     mutable abt::shared_mutex m_mutex;
     std::unordered_map<std::uint64_t, std::vector<file_status>> m_requests;
+    std::unordered_map<std::uint64_t, std::set<std::size_t>> m_workers;
 };
 
 } // namespace cargo
@@ -0,0 +1,329 @@
+/******************************************************************************
+ * Copyright 2022-2023, Barcelona Supercomputing Center (BSC), Spain
+ *
+ * This software was partially supported by the EuroHPC-funded project ADMIRE
+ *   (Project ID: 956748, https://www.admire-eurohpc.eu).
+ *
+ * This file is part of Cargo.
+ *
+ * Cargo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cargo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cargo.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *****************************************************************************/
+
+
+#include <logger/logger.hpp>
+#include <boost/mpi.hpp>
+#include "batch.hpp"
+#include "fmt_formatters.hpp"
+
+namespace mpi = boost::mpi;
+
+namespace cargo {
+
+batch_operation::batch_operation(const batch_message& m,
+                                 std::uint64_t block_size)
+    : m_kb_size(block_size), m_fs_i_type(m.i_type()),
+      m_fs_o_type(m.o_type()) {
+
+    m_files.reserve(m.size());
+
+    for(std::size_t i = 0; i < m.size(); ++i) {
+        auto& f = m_files.emplace_back();
+        f.seqno = m.seqnos()[i];
+        f.input_path = m.input_paths()[i];
+        f.output_path = m.output_paths()[i];
+    }
+}
+
+cargo::error_code
+batch_operation::operator()() {
+
+    m_status = error_code::transfer_in_progress;
+    try {
+        std::size_t block_size = m_kb_size * 1024u;
+
+        // the slots of compressed containers must fit in the pipeline
+        if(compression()) {
+            block_size = std::max(
+                    block_size, posix_file::block_container::default_block_size);
+        }
+
+        // step 1. acquire the buffers of the block pipeline once for the
+        // whole batch
+        const std::size_t depth = std::max<std::size_t>(
+                std::min(std::max(pipeline_depth(), pool()->size()),
+                         blocks_per_round(block_size)),
+                1);
+
+        // each block copy takes two requests (a read and a linked write)
+        m_pipeline = std::make_unique<block_pipeline>(
+                pool(), depth, block_size, make_io_queue(2 * depth));
+
+        if(verify()) {
+            m_pipeline->enable_verification();
+        }
+
+    } catch(const std::system_error& e) {
+        LOGGER_ERROR("Unexpected system error: {}", e.what());
+        m_status = make_system_error(e.code().value());
+        return make_system_error(e.code().value());
+    } catch(const std::exception& e) {
+        LOGGER_ERROR("Unexpected exception: {}", e.what());
+        m_status = error_code::other;
+        return error_code::other;
+    }
+
+    return error_code::transfer_in_progress;
+}
+
+cargo::error_code
+batch_operation::progress() const {
+    return m_status;
+}
+
+bool
+batch_operation::open(file_transfer& f) {
+
+    try {
+        f.input = std::make_unique<posix_file::file>(
+                posix_file::open(f.input_path, O_RDONLY, 0, m_fs_i_type));
+        std::size_t file_size = f.input->size();
+        std::size_t block_size = m_kb_size * 1024u;
+
+        if(compression()) {
+            f.container = posix_file::block_container::probe(*f.input);
+
+            if(f.container) {
+                f.decompress = true;
+                f.container_size = file_size;
+                file_size = f.container->file_size();
+
+                if(f.container->block_size() > m_pipeline->block_size()) {
+                    throw posix_file::io_error("batch_operation::open",
+                                               EFBIG);
+                }
+            } else if(m_fs_o_type == FSPlugin::type::posix &&
+                      m_fs_i_type != FSPlugin::type::posix &&
+                      m_fs_i_type != FSPlugin::type::parallel) {
+                f.container = posix_file::block_container{
+                        file_size,
+                        posix_file::block_container::default_block_size};
+            }
+
+            if(f.container) {
+                block_size = f.container->payload_size();
+            }
+        }
+
+        f.output = std::make_unique<posix_file::file>(posix_file::create(
+                f.output_path, incremental() || verify() ? O_RDWR : O_WRONLY,
+                S_IRUSR | S_IWUSR, m_fs_o_type));
+
+        if(f.container && !f.decompress) {
+            // the unused tail of each slot is left as a hole
+            f.output->truncate(f.container->capacity());
+        } else {
+            // in incremental mode, the blocks already in the output file are
+            // read back, so it must not keep any data beyond the input size
+            if(incremental()) {
+                f.output->truncate(file_size);
+            }
+
+            f.output->fallocate(0, 0, file_size);
+        }
+
+        f.digest = posix_file::file_digest{file_size};
+        m_plan = posix_file::block_plan{file_size, block_size};
+        m_next_block = 0;
+        return true;
+    } catch(const posix_file::io_error& e) {
+        LOGGER_ERROR("{}() failed: {}", e.where(), e.what());
+        f.error = make_system_error(e.error_code());
+    } catch(const std::system_error& e) {
+        LOGGER_ERROR("Unexpected system error: {}", e.what());
+        f.error = make_system_error(e.code().value());
+    }
+
+    f.issued = true;
+    finish(f);
+    return false;
+}
+
+void
+batch_operation::finish(file_transfer& f) {
+
+    if(!f.issued || f.in_flight != 0) {
+        return;
+    }
+
+    // the I/O queue is shared by all the files of the batch, and their
+    // descriptors may be reused by the next ones
+    if(f.output) {
+        m_pipeline->release(*f.output);
+    }
+    if(f.input) {
+        m_pipeline->release(*f.input);
+    }
+
+    f.output.reset();
+    f.input.reset();
+    f.done = true;
+}
+
+int
+batch_operation::progress(int ongoing_index) {
+
+    try {
+        m_status = error_code::transfer_in_progress;
+
+        // step 2. keep the pipeline full with the blocks of as many files
+        // as needed, as long as the rate limit allows it
+        while(m_next_file < m_files.size() && !m_pipeline->full() &&
+              !throttled()) {
+
+            auto& f = m_files[m_next_file];
+
+            if(!f.input && !open(f)) {
+                ++m_next_file;
+                continue;
+            }
+
+            // stop issuing the blocks of a file once one of them has failed
+            if(m_next_block == m_plan.size() || f.error) {
+                f.issued = true;
+                finish(f);
+                ++m_next_file;
+                continue;
+            }
+
+            const auto range = m_plan[m_next_block++];
+            consume(range.size());
+
+            if(f.container && f.decompress) {
+                m_pipeline->issue_decompress(*f.input, f.container_size,
+                                             *f.output, *f.container, range);
+            } else if(f.container) {
+                m_pipeline->issue_compress(
+                        *f.input, *f.output, *f.container, range,
+                        posix_file::block_container::default_level);
+            } else if(incremental()) {
+                m_pipeline->issue_update(*f.input, *f.output, range);
+            } else {
+                m_pipeline->issue_copy(*f.input, *f.output, range);
+            }
+
+            m_in_flight.push_back(m_next_file);
+            ++f.in_flight;
+        }
+
+        if(m_pipeline->empty()) {
+            if(m_next_file < m_files.size()) {
+                // throttled: let other operations progress in the meantime
+                return ongoing_index;
+            }
+            m_status = error_code::success;
+            return -1;
+        }
+
+        // step 3. account for the oldest block once it has been written
+        auto& f = m_files[m_in_flight.front()];
+        m_in_flight.pop_front();
+        --f.in_flight;
+
+        try {
+            const auto block = m_pipeline->wait();
+            account(block.bytes);
+
+            if(verify()) {
+                f.digest.add(block.range, block.checksum);
+            }
+        } catch(const posix_file::io_error& e) {
+            LOGGER_ERROR("{}() failed: {}", e.where(), e.what());
+            f.error = make_system_error(e.error_code());
+        }
+
+        finish(f);
+
+        if(m_next_file == m_files.size() && m_pipeline->empty()) {
+            m_status = error_code::success;
+            return -1;
+        }
+    } catch(const std::system_error& e) {
+        LOGGER_ERROR("Unexpected system error: {}", e.what());
+        m_status = make_system_error(e.code().value());
+        return -1;
+    } catch(const std::exception& e) {
+        LOGGER_ERROR("Unexpected exception: {}", e.what());
+        m_status = error_code::other;
+        return -1;
+    }
+
+    return ongoing_index + 1;
+}
+
+void
+batch_operation::update_state(transfer_state st, float bw,
+                              std::optional<error_code> ec) {
+
+    (void) bw;
+
+    // files are only reported once the whole batch is over. Until then, the
+    // master considers them pending
+    if(st != transfer_state::completed && st != transfer_state::failed) {
+        return;
+    }
+
+    mpi::communicator world;
+
+    const auto send = [&](const batch_status_message& m) {
+        if(m.size() == 0) {
+            return;
+        }
+        LOGGER_DEBUG("msg <= to: {} body: {{payload: {}}}", source(), m);
+        world.send(source(), static_cast<int>(tag::batch_status), m);
+    };
+
+    batch_status_message completed{tid(), transfer_state::completed, 0.0f};
+
+    for(const auto& f : m_files) {
+
+        if(f.done && !f.error) {
+            completed.add(f.seqno, f.output_path,
+                          verify() ? std::optional{f.digest.value()}
+                                   : std::nullopt);
+            continue;
+        }
+
+        // files that were not finished share the error of the whole batch
+        batch_status_message failed{tid(), transfer_state::failed, 0.0f,
+                                    f.error ? f.error : ec};
+        failed.add(f.seqno, f.output_path);
+        send(failed);
+    }
+
+    send(completed);
+}
+
+std::string
+batch_operation::output_path() const {
+    return m_files.empty() ? std::string{} : m_files.front().output_path.string();
+}
+
+std::string
+batch_operation::input_path() const {
+    return m_files.empty() ? std::string{} : m_files.front().input_path.string();
+}
+
+} // namespace cargo
@@ -0,0 +1,119 @@
+/******************************************************************************
+ * Copyright 2022-2023, Barcelona Supercomputing Center (BSC), Spain
+ *
+ * This software was partially supported by the EuroHPC-funded project ADMIRE
+ *   (Project ID: 956748, https://www.admire-eurohpc.eu).
+ *
+ * This file is part of Cargo.
+ *
+ * Cargo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cargo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cargo.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *****************************************************************************/
+
+
+#ifndef CARGO_WORKER_BATCH_HPP
+#define CARGO_WORKER_BATCH_HPP
+
+#include <deque>
+#include <posix_file/file.hpp>
+#include <posix_file/block_plan.hpp>
+#include "ops.hpp"
+#include "pipeline.hpp"
+
+namespace cargo {
+
+/**
+ * The transfer of a batch of whole files by a single worker.
+ *
+ * Files are transferred back to back through a single block pipeline, so that
+ * its buffers are allocated once for the whole batch and the blocks of
+ * consecutive files overlap. The outcome of each file is reported to the
+ * master in aggregate once the whole batch has finished.
+ */
+class batch_operation : public operation {
+
+public:
+    batch_operation(const batch_message& m, std::uint64_t block_size);
+
+    cargo::error_code
+    operator()() final;
+
+    cargo::error_code
+    progress() const final;
+
+    int
+    progress(int ongoing_index) final;
+
+    void
+    update_state(transfer_state st, float bw,
+                 std::optional<error_code> ec = std::nullopt) final;
+
+    std::string
+    output_path() const final;
+
+    std::string
+    input_path() const final;
+
+private:
+    struct file_transfer {
+        std::uint32_t seqno{};
+        std::filesystem::path input_path;
+        std::filesystem::path output_path;
+        std::unique_ptr<posix_file::file> input;
+        std::unique_ptr<posix_file::file> output;
+        // blocks of the file in the pipeline
+        std::size_t in_flight = 0;
+        // all the blocks of the file have been issued
+        bool issued = false;
+        bool done = false;
+        std::optional<error_code> error;
+        // digest of the blocks of the file, in verify mode
+        posix_file::file_digest digest;
+        // layout of the output file if it is compressed, or of the input
+        // file if it is decompressed
+        std::optional<posix_file::block_container> container;
+        bool decompress = false;
+        // size of the container read from the input file, if it is
+        // decompressed
+        std::size_t container_size = 0;
+    };
+
+    // Open the files of `f` and compute its block plan. Returns false if the
+    // transfer of `f` failed
+    bool
+    open(file_transfer& f);
+
+    // Release the files of `f` once it has no blocks left
+    void
+    finish(file_transfer& f);
+
+    std::vector<file_transfer> m_files;
+    // File whose blocks are being issued, and its block plan
+    std::size_t m_next_file = 0;
+    std::size_t m_next_block = 0;
+    posix_file::block_plan m_plan;
+    // File of each block in the pipeline, in issue order
+    std::deque<std::size_t> m_in_flight;
+    // must be destroyed before the files, since in-flight blocks use them
+    std::unique_ptr<block_pipeline> m_pipeline;
+    std::uint64_t m_kb_size;
+    FSPlugin::type m_fs_i_type;
+    FSPlugin::type m_fs_o_type;
+    cargo::error_code m_status;
+};
+
+} // namespace cargo
+
+#endif // CARGO_WORKER_BATCH_HPP
@@ -0,0 +1,91 @@
+/******************************************************************************
+ * Copyright 2022-2023, Barcelona Supercomputing Center (BSC), Spain
+ *
+ * This software was partially supported by the EuroHPC-funded project ADMIRE
+ *   (Project ID: 956748, https://www.admire-eurohpc.eu).
+ *
+ * This file is part of Cargo.
+ *
+ * Cargo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cargo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cargo.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *****************************************************************************/
+
+#include "block_queue.hpp"
+#include <algorithm>
+
+namespace cargo {
+
+block_queue::block_queue(const posix_file::block_plan& plan) : m_plan(plan) {
+    grant(0, plan.size());
+}
+
+block_queue::block_queue(const posix_file::block_plan& plan, std::size_t first,
+                         std::size_t count, std::size_t low_water)
+    : m_plan(plan), m_low_water(low_water), m_exhausted(false) {
+    grant(first, count);
+}
+
+std::optional<posix_file::ranges::range>
+block_queue::next() {
+
+    if(m_chunks.empty()) {
+        return std::nullopt;
+    }
+
+    auto& [begin, end] = m_chunks.front();
+    const auto range = m_plan[begin++];
+
+    if(begin == end) {
+        m_chunks.pop_front();
+    }
+
+    --m_available;
+    return range;
+}
+
+bool
+block_queue::done() const {
+    return m_exhausted && m_chunks.empty();
+}
+
+bool
+block_queue::needs_claim() const {
+    return !m_exhausted && !m_claim_pending && m_available <= m_low_water;
+}
+
+void
+block_queue::claim_sent() {
+    m_claim_pending = true;
+}
+
+void
+block_queue::grant(std::size_t first, std::size_t count) {
+
+    m_claim_pending = false;
+
+    if(count == 0) {
+        m_exhausted = true;
+        return;
+    }
+
+    const auto end = std::min(first + count, m_plan.size());
+
+    if(first < end) {
+        m_chunks.emplace_back(first, end);
+        m_available += end - first;
+    }
+}
+
+} // namespace cargo
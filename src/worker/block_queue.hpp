@@ -0,0 +1,92 @@
+/******************************************************************************
+ * Copyright 2022-2023, Barcelona Supercomputing Center (BSC), Spain
+ *
+ * This software was partially supported by the EuroHPC-funded project ADMIRE
+ *   (Project ID: 956748, https://www.admire-eurohpc.eu).
+ *
+ * This file is part of Cargo.
+ *
+ * Cargo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cargo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cargo.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *****************************************************************************/
+
+#ifndef CARGO_WORKER_BLOCK_QUEUE_HPP
+#define CARGO_WORKER_BLOCK_QUEUE_HPP
+
+#include <deque>
+#include <optional>
+#include <utility>
+#include <posix_file/block_plan.hpp>
+
+namespace cargo {
+
+/**
+ * The blocks of a file that a worker still has to transfer.
+ *
+ * The blocks may be assigned to the worker beforehand, or handed out by the
+ * master in chunks of consecutive blocks while the transfer progresses. In
+ * the latter case, the worker should claim a new chunk whenever
+ * `needs_claim()` returns true, and pass the reply of the master to
+ * `grant()`. Claims are sent before the worker runs out of blocks, so that
+ * its pipeline doesn't drain while the reply is on its way.
+ */
+class block_queue {
+
+public:
+    block_queue() = default;
+
+    // All the blocks in `plan` belong to this worker
+    explicit block_queue(const posix_file::block_plan& plan);
+
+    // The blocks in `plan` are handed out by the master, and this worker
+    // starts with the `count` blocks from `first`. A new chunk is claimed
+    // once no more than `low_water` blocks are left
+    block_queue(const posix_file::block_plan& plan, std::size_t first,
+                std::size_t count, std::size_t low_water);
+
+    // The range of the next block to transfer, if any is available now
+    std::optional<posix_file::ranges::range>
+    next();
+
+    // Whether no blocks are left, nor will be granted
+    bool
+    done() const;
+
+    // Whether a new chunk of blocks should be claimed from the master
+    bool
+    needs_claim() const;
+
+    void
+    claim_sent();
+
+    // Add the `count` blocks from `first` granted by the master. A `count`
+    // of 0 means that no blocks are left to hand out
+    void
+    grant(std::size_t first, std::size_t count);
+
+private:
+    posix_file::block_plan m_plan;
+    // chunks of blocks not transferred yet, as [begin, end) positions in
+    // the plan
+    std::deque<std::pair<std::size_t, std::size_t>> m_chunks;
+    std::size_t m_available = 0;
+    std::size_t m_low_water = 0;
+    bool m_claim_pending = false;
+    bool m_exhausted = true;
+};
+
+} // namespace cargo
+
+#endif // CARGO_WORKER_BLOCK_QUEUE_HPP
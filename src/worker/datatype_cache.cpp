@@ -0,0 +1,73 @@
+/******************************************************************************
+ * Copyright 2022-2023, Barcelona Supercomputing Center (BSC), Spain
+ *
+ * This software was partially supported by the EuroHPC-funded project ADMIRE
+ *   (Project ID: 956748, https://www.admire-eurohpc.eu).
+ *
+ * This file is part of Cargo.
+ *
+ * Cargo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cargo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cargo.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *****************************************************************************/
+
+#include "datatype_cache.hpp"
+#include <algorithm>
+
+namespace cargo {
+
+datatype_cache::datatype_cache(std::size_t capacity)
+    : m_capacity(std::max<std::size_t>(capacity, 1)) {}
+
+std::shared_ptr<const block_layout>
+datatype_cache::get(std::size_t block_size, std::size_t total_blocks,
+                    std::size_t workers) {
+
+    const key k{block_size, total_blocks, workers};
+
+    if(const auto it = m_index.find(k); it != m_index.end()) {
+        m_entries.splice(m_entries.begin(), m_entries, it->second);
+        return it->second->second;
+    }
+
+    /*
+     * count: number of blocks in the type
+     * blocklen: number of `oldtype` elements in each block
+     * stride: number of `oldtype` elements between start of each block
+     */
+    auto block_type = mpioxx::datatype::contiguous(
+            static_cast<int>(block_size), MPI_BYTE);
+    auto file_type = mpioxx::datatype::vector(
+            /* count: */ static_cast<int>(total_blocks), /* blocklength: */ 1,
+            /* stride: */ static_cast<int>(workers), /* oldtype: */ block_type);
+
+    auto layout = std::make_shared<const block_layout>(
+            block_layout{std::move(block_type), std::move(file_type)});
+
+    if(m_entries.size() >= m_capacity) {
+        m_index.erase(m_entries.back().first);
+        m_entries.pop_back();
+    }
+
+    m_entries.emplace_front(k, layout);
+    m_index.emplace(k, m_entries.begin());
+    return layout;
+}
+
+std::size_t
+datatype_cache::size() const noexcept {
+    return m_entries.size();
+}
+
+} // namespace cargo
@@ -0,0 +1,90 @@
+/******************************************************************************
+ * Copyright 2022-2023, Barcelona Supercomputing Center (BSC), Spain
+ *
+ * This software was partially supported by the EuroHPC-funded project ADMIRE
+ *   (Project ID: 956748, https://www.admire-eurohpc.eu).
+ *
+ * This file is part of Cargo.
+ *
+ * Cargo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cargo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cargo.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *****************************************************************************/
+
+#ifndef CARGO_WORKER_DATATYPE_CACHE_HPP
+#define CARGO_WORKER_DATATYPE_CACHE_HPP
+
+#include <cstddef>
+#include <list>
+#include <map>
+#include <memory>
+#include <tuple>
+#include <utility>
+#include "mpioxx.hpp"
+
+namespace cargo {
+
+/**
+ * The committed MPI datatypes that stride the blocks of a file among the
+ * workers, for the file views of collective transfers.
+ */
+struct block_layout {
+    // A block of `block_size` bytes
+    mpioxx::datatype block_type;
+    // Every `workers`-th block of the file, out of `total_blocks`. Each rank
+    // sets it as its file view with a displacement of `rank` blocks
+    mpioxx::datatype file_type;
+};
+
+/**
+ * A cache of the block layouts of the files transferred collectively.
+ *
+ * Layouts are keyed on their geometry, so files of the same size (in
+ * blocks) share them instead of creating and committing new datatypes. The
+ * least recently used layout is dropped once the cache holds `capacity`
+ * of them, and its datatypes are freed as soon as the last operation using
+ * them is done.
+ *
+ * The cache is not thread-safe: it is used by the thread that starts the
+ * operations of a worker.
+ */
+class datatype_cache {
+
+public:
+    static constexpr std::size_t default_capacity = 64;
+
+    explicit datatype_cache(std::size_t capacity = default_capacity);
+
+    // The layout of `total_blocks` blocks of `block_size` bytes strided
+    // among `workers` ranks
+    std::shared_ptr<const block_layout>
+    get(std::size_t block_size, std::size_t total_blocks,
+        std::size_t workers);
+
+    std::size_t
+    size() const noexcept;
+
+private:
+    using key = std::tuple<std::size_t, std::size_t, std::size_t>;
+    using entry = std::pair<key, std::shared_ptr<const block_layout>>;
+
+    std::size_t m_capacity;
+    // most recently used first
+    std::list<entry> m_entries;
+    std::map<key, std::list<entry>::iterator> m_index;
+};
+
+} // namespace cargo
+
+#endif // CARGO_WORKER_DATATYPE_CACHE_HPP
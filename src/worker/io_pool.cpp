@@ -0,0 +1,134 @@
+/******************************************************************************
+ * Copyright 2022-2023, Barcelona Supercomputing Center (BSC), Spain
+ *
+ * This software was partially supported by the EuroHPC-funded project ADMIRE
+ *   (Project ID: 956748, https://www.admire-eurohpc.eu).
+ *
+ * This file is part of Cargo.
+ *
+ * Cargo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cargo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cargo.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *****************************************************************************/
+
+
+#include "io_pool.hpp"
+
+namespace cargo {
+
+io_pool::io_pool(std::size_t size) {
+
+    m_threads.reserve(std::max<std::size_t>(size, 1));
+
+    for(std::size_t i = 0; i < std::max<std::size_t>(size, 1); ++i) {
+        m_threads.emplace_back(
+                [this](const std::stop_token& stop) { run(stop); });
+    }
+}
+
+io_pool::~io_pool() {
+    for(auto& t : m_threads) {
+        t.request_stop();
+    }
+    m_cv.notify_all();
+    // std::jthread joins on destruction
+}
+
+std::size_t
+io_pool::size() const noexcept {
+    return m_threads.size();
+}
+
+void
+io_pool::run(const std::stop_token& stop) {
+
+    while(true) {
+        std::function<void()> task;
+
+        {
+            std::unique_lock lock{m_mutex};
+
+            // keep running queued tasks after a stop request so that no
+            // future is left without a value
+            if(!m_cv.wait(lock, stop, [this] { return !m_tasks.empty(); })) {
+                return;
+            }
+
+            task = std::move(m_tasks.front());
+            m_tasks.pop_front();
+        }
+
+        task();
+    }
+}
+
+completion_queue::~completion_queue() {
+    for(auto& task : m_tasks) {
+        try {
+            get(task);
+        } catch(...) {
+            // errors are only reported to callers of pop()
+        }
+    }
+}
+
+std::size_t
+completion_queue::size() const noexcept {
+    return m_tasks.size();
+}
+
+bool
+completion_queue::empty() const noexcept {
+    return m_tasks.empty();
+}
+
+void
+completion_queue::push(std::future<std::size_t> f) {
+    m_tasks.emplace_back(std::move(f));
+}
+
+void
+completion_queue::push(posix_file::io_queue& queue,
+                       posix_file::io_queue::ticket t) {
+    m_tasks.emplace_back(queued_request{&queue, t});
+}
+
+void
+completion_queue::push_ready(std::size_t result) {
+    m_tasks.emplace_back(result);
+}
+
+std::size_t
+completion_queue::pop() {
+    auto task = std::move(m_tasks.front());
+    m_tasks.pop_front();
+    return get(task);
+}
+
+std::size_t
+completion_queue::get(pending_task& task) {
+
+    if(auto* f = std::get_if<std::future<std::size_t>>(&task)) {
+        return f->get();
+    }
+
+    if(const auto* n = std::get_if<std::size_t>(&task)) {
+        return *n;
+    }
+
+    const auto& r = std::get<queued_request>(task);
+    return r.queue->wait(r.ticket);
+}
+
+} // namespace cargo
@@ -0,0 +1,154 @@
+/******************************************************************************
+ * Copyright 2022-2023, Barcelona Supercomputing Center (BSC), Spain
+ *
+ * This software was partially supported by the EuroHPC-funded project ADMIRE
+ *   (Project ID: 956748, https://www.admire-eurohpc.eu).
+ *
+ * This file is part of Cargo.
+ *
+ * Cargo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cargo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cargo.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *****************************************************************************/
+
+
+#ifndef CARGO_WORKER_IO_POOL_HPP
+#define CARGO_WORKER_IO_POOL_HPP
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+#include <type_traits>
+#include <variant>
+#include <vector>
+#include <posix_file/io_queue.hpp>
+
+namespace cargo {
+
+/**
+ * A fixed-size pool of threads that execute I/O tasks on behalf of the
+ * operations of a worker rank.
+ *
+ * Tasks are started in submission order, but may complete in any order. Their
+ * results (or any exception they raise) are delivered through the returned
+ * `std::future`.
+ */
+class io_pool {
+
+public:
+    explicit io_pool(std::size_t size);
+
+    io_pool(const io_pool&) = delete;
+    io_pool&
+    operator=(const io_pool&) = delete;
+
+    ~io_pool();
+
+    std::size_t
+    size() const noexcept;
+
+    template <typename Function>
+    std::future<std::invoke_result_t<Function>>
+    submit(Function&& f) {
+
+        using result_type = std::invoke_result_t<Function>;
+
+        auto task = std::make_shared<std::packaged_task<result_type()>>(
+                std::forward<Function>(f));
+        auto result = task->get_future();
+
+        {
+            const std::lock_guard lock{m_mutex};
+            m_tasks.emplace_back([task] { (*task)(); });
+        }
+
+        m_cv.notify_one();
+        return result;
+    }
+
+private:
+    void
+    run(const std::stop_token& stop);
+
+    std::mutex m_mutex;
+    std::condition_variable_any m_cv;
+    std::deque<std::function<void()>> m_tasks;
+    std::vector<std::jthread> m_threads;
+};
+
+/**
+ * The results of a sequence of I/O tasks, consumed in submission order. Tasks
+ * can either run in an `io_pool` or be requests queued in a
+ * `posix_file::io_queue`, which must outlive the `completion_queue`. Tasks
+ * that need no I/O at all can also be queued with their result.
+ *
+ * Outstanding tasks are waited for on destruction, so that the buffers they
+ * use can be safely released afterwards.
+ */
+class completion_queue {
+
+public:
+    completion_queue() = default;
+
+    completion_queue(const completion_queue&) = delete;
+    completion_queue&
+    operator=(const completion_queue&) = delete;
+
+    ~completion_queue();
+
+    std::size_t
+    size() const noexcept;
+
+    bool
+    empty() const noexcept;
+
+    void
+    push(std::future<std::size_t> f);
+
+    void
+    push(posix_file::io_queue& queue, posix_file::io_queue::ticket t);
+
+    // Queue a task that has already completed with `result`
+    void
+    push_ready(std::size_t result);
+
+    // Wait for the oldest task and return its result, rethrowing any error
+    // it raised
+    std::size_t
+    pop();
+
+private:
+    struct queued_request {
+        posix_file::io_queue* queue;
+        posix_file::io_queue::ticket ticket;
+    };
+
+    using pending_task =
+            std::variant<std::future<std::size_t>, queued_request,
+                         std::size_t>;
+
+    static std::size_t
+    get(pending_task& task);
+
+    std::deque<pending_task> m_tasks;
+};
+
+} // namespace cargo
+
+#endif // CARGO_WORKER_IO_POOL_HPP
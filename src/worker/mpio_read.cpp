@@ -26,6 +26,7 @@
 #include "mpio_read.hpp"
 #include "mpioxx.hpp"
 #include "memory.hpp"
+#include "pipeline.hpp"
 #include <thread>
 
 namespace cargo {
@@ -48,17 +49,15 @@ mpio_read::operator()() {
     m_status = error_code::transfer_in_progress;
     try {
 
-        const auto input_file = mpioxx::file::open(
-                m_workers, m_input_path, mpioxx::file_open_mode::rdonly);
+        // all ranks get the same hints, as required by the collective open
+        const mpioxx::info hints{mpio_hints()};
 
-        mpioxx::offset file_size = input_file.size();
-        std::size_t block_size = m_kb_size * 1024u;
+        m_input_file = std::make_unique<mpioxx::file>(
+                mpioxx::file::open(m_workers, m_input_path,
+                                   mpioxx::file_open_mode::rdonly, hints));
 
-        // create block type
-        MPI_Datatype block_type;
-        MPI_Type_contiguous(static_cast<int>(block_size), MPI_BYTE,
-                            &block_type);
-        MPI_Type_commit(&block_type);
+        mpioxx::offset file_size = m_input_file->size();
+        std::size_t block_size = m_kb_size * 1024u;
 
         // compute the number of blocks in the file
         int total_blocks = static_cast<int>(file_size / block_size);
@@ -70,69 +69,91 @@ mpio_read::operator()() {
         const auto workers_size = m_workers.size();
         const auto workers_rank = m_workers.rank();
 
-        // create file type
-        MPI_Datatype file_type;
-        /*
-         * count: number of blocks in the type
-         * blocklen: number of elements in each block
-         * stride: number of elements between start of each block
-         */
-        MPI_Type_vector(/* count: */ total_blocks, /* blocklength: */ 1,
-                        /* stride: */ workers_size, /* oldtype: */ block_type,
-                        &file_type);
-        MPI_Type_commit(&file_type);
+        // The collective read is split in rounds so that the memory used by
+        // each rank is bounded. All ranks must take part in every round, so
+        // the number of rounds is derived from the largest share of blocks,
+        // which is the same for all of them. It is computed before any step
+        // that may fail locally, so that this rank can still take part in
+        // the rounds if one does
+        const std::size_t max_blocks_per_rank =
+                (total_blocks + workers_size - 1) / workers_size;
+        const std::size_t blocks_per_round =
+                operation::blocks_per_round(block_size);
+
+        m_rounds = (max_blocks_per_rank + blocks_per_round - 1) /
+                   blocks_per_round;
+        m_round = 0;
+        m_blocks_read = 0;
+
+        // the block and file types are shared with other files of the same
+        // geometry. The block type is kept for the collective reads
+        m_layout = datatypes()->get(block_size, total_blocks, workers_size);
 
         MPI_Offset disp = workers_rank * block_size;
-        MPI_Datatype etype = block_type;
-        MPI_Datatype filetype = file_type;
 
-        if(const auto ec = MPI_File_set_view(input_file, disp, etype, filetype,
-                                             "native", MPI_INFO_NULL);
+        if(const auto ec = MPI_File_set_view(
+                   *m_input_file, disp, m_layout->block_type,
+                   m_layout->file_type, "native", hints);
            ec != MPI_SUCCESS) {
-            LOGGER_ERROR("MPI_File_set_view() failed: {}",
-                         mpi::error_string(ec));
-            return make_mpi_error(ec);
+            throw mpioxx::io_error("MPI_File_set_view", ec);
         }
 
-        // find how many blocks this rank is responsible for
-        std::size_t blocks_per_rank = total_blocks / workers_size;
+        // find which blocks this rank is responsible for
+        m_plan = posix_file::block_plan{static_cast<std::size_t>(file_size),
+                                        block_size,
+                                        static_cast<std::size_t>(workers_size),
+                                        static_cast<std::size_t>(workers_rank)};
+        const std::size_t blocks_per_rank = m_plan.size();
 
-        if(int64_t n = total_blocks % workers_size;
-           n != 0 && workers_rank < n) {
-            ++blocks_per_rank;
-        }
+        // step 1. acquire buffers (enough for a single round)
+        const std::size_t buffered_blocks =
+                std::min(blocks_per_rank, blocks_per_round);
 
-        // step 1. acquire buffers
+        m_buffer.resize(buffered_blocks * block_size);
 
-        m_buffer.resize(blocks_per_rank * block_size);
+        m_buffer_regions.reserve(buffered_blocks);
 
-        m_buffer_regions.reserve(blocks_per_rank);
-
-        for(std::size_t i = 0; i < blocks_per_rank; ++i) {
+        for(std::size_t i = 0; i < buffered_blocks; ++i) {
             m_buffer_regions.emplace_back(m_buffer.data() + i * block_size,
                                           block_size);
         }
 
-        MPI_Datatype datatype = block_type;
+        m_blocks_per_round = blocks_per_round;
 
-        // step2. parallel read data into buffers
-        if(const auto ec = MPI_File_read_all(input_file, m_buffer.data(),
-                                             static_cast<int>(blocks_per_rank),
-                                             datatype, MPI_STATUS_IGNORE);
-           ec != MPI_SUCCESS) {
-            LOGGER_ERROR("MPI_File_read_all() failed: {}",
-                         mpi::error_string(ec));
-            return make_mpi_error(ec);
-        }
+        // step2. parallel read data into buffers is done in rounds by
+        // progress()
 
         // step3. POSIX write data
         // We need to create the directory if it does not exists (using
         // FSPlugin)
         m_output_file = std::make_unique<posix_file::file>(posix_file::create(
-                m_output_path, O_WRONLY, S_IRUSR | S_IWUSR, m_fs_o_type));
+                m_output_path, incremental() || verify() ? O_RDWR : O_WRONLY,
+                S_IRUSR | S_IWUSR, m_fs_o_type));
+
+        // in incremental mode, the blocks already in the output file are
+        // read back, so it must not keep any data beyond the input size
+        if(incremental()) {
+            m_output_file->truncate(file_size);
+        }
+
+        if(incremental() || verify()) {
+            m_output_buffer.resize(m_buffer.size());
+        }
+
+        if(verify()) {
+            m_checksums.assign(buffered_blocks, 0);
+            m_digest = posix_file::file_digest{
+                    static_cast<std::size_t>(file_size)};
+        }
 
         m_output_file->fallocate(0, 0, file_size);
 
+        m_io_queue =
+                make_io_queue(std::min(buffered_blocks, pipeline_depth()));
+
+        if(m_io_queue) {
+            m_io_queue->register_buffer(m_buffer);
+        }
 
         m_workers_size = workers_size;
         m_workers_rank = workers_rank;
@@ -142,102 +163,195 @@ mpio_read::operator()() {
     } catch(const mpioxx::io_error& e) {
         LOGGER_ERROR("{}() failed: {}", e.where(), e.what());
         m_status = make_mpi_error(e.error_code());
+        abandon_rounds();
         return make_mpi_error(e.error_code());
     } catch(const posix_file::io_error& e) {
         LOGGER_ERROR("{}() failed: {}", e.where(), e.what());
         m_status = make_system_error(e.error_code());
+        abandon_rounds();
         return make_system_error(e.error_code());
     } catch(const std::system_error& e) {
         LOGGER_ERROR("Unexpected system error: {}", e.what());
         m_status = make_system_error(e.code().value());
+        abandon_rounds();
         return make_system_error(e.code().value());
     } catch(const std::exception& e) {
         LOGGER_ERROR("operator ()() Unexpected exception: {}", e.what());
         m_status = error_code::other;
+        abandon_rounds();
         return error_code::other;
     }
     m_status = error_code::transfer_in_progress;
     return error_code::transfer_in_progress;
 }
 
+void
+mpio_read::read_round() {
+
+    // ranks that have already read all their blocks still need to take part
+    // in the collective call, albeit with an empty request
+    const std::size_t count =
+            std::min(m_blocks_per_round, m_plan.size() - m_blocks_read);
+
+    const auto ec = MPI_File_read_all(*m_input_file, m_buffer.data(),
+                                      static_cast<int>(count),
+                                      m_layout->block_type, MPI_STATUS_IGNORE);
+
+    // this rank took part in the round even if it failed
+    ++m_round;
+
+    if(ec != MPI_SUCCESS) {
+        throw mpioxx::io_error("MPI_File_read_all", ec);
+    }
+
+    // hand the blocks of this round to the I/O queue (or the I/O pool) so
+    // that they are written concurrently
+    const bool queued = m_io_queue && m_io_queue->async(*m_output_file) &&
+                        !incremental() && !verify();
+
+    for(std::size_t k = m_blocks_read; k < m_blocks_read + count; ++k) {
+        const auto range = m_plan[k];
+        const std::size_t slot = k % m_blocks_per_round;
+        const auto region = m_buffer_regions[slot];
+
+        assert(region.size() >= range.size());
+
+        if(incremental() || verify()) {
+            const buffer_region current{
+                    m_output_buffer.data() + (region.data() - m_buffer.data()),
+                    region.size()};
+
+            m_writes.push(pool()->submit([this, slot, region, current,
+                                          range] {
+                if(verify()) {
+                    m_checksums[slot] = posix_file::crc32c(0, region.data(),
+                                                           range.size());
+                }
+
+                if(!incremental()) {
+                    m_output_file->pwrite(region, range.offset(),
+                                          range.size());
+                } else if(!write_if_changed(*m_output_file, region, current,
+                                            range)) {
+                    m_unchanged.fetch_add(1, std::memory_order_relaxed);
+                    return range.size();
+                }
+
+                if(verify()) {
+                    check_written(*m_output_file, current, range,
+                                  m_checksums[slot]);
+                }
+                return range.size();
+            }));
+            continue;
+        }
+
+        if(queued) {
+            m_writes.push(*m_io_queue,
+                          m_io_queue->write(*m_output_file, region,
+                                            range.offset(), range.size()));
+            continue;
+        }
+
+        m_writes.push(pool()->submit([this, region, range] {
+            return m_output_file->pwrite(region, range.offset(), range.size());
+        }));
+    }
+
+    if(queued) {
+        m_io_queue->submit();
+    }
+
+    m_blocks_read += count;
+}
+
+void
+mpio_read::abandon_rounds() noexcept {
+
+    // the other ranks block in their collective calls until this rank
+    // has taken part in all the rounds, so do so with empty requests
+    if(!m_input_file) {
+        return;
+    }
+
+    // the view may have failed to be set up
+    const auto type = m_layout ? m_layout->block_type : MPI_BYTE;
+
+    for(; m_round < m_rounds; ++m_round) {
+        MPI_File_read_all(*m_input_file, m_buffer.data(), 0, type,
+                          MPI_STATUS_IGNORE);
+    }
+}
+
 int
 mpio_read::progress(int ongoing_index) {
 
-    using posix_file::views::all_of;
-    using posix_file::views::as_blocks;
-    using posix_file::views::strided;
     try {
-        int index = 0;
-        // TODO : FS not defined...
-
         m_status = error_code::transfer_in_progress;
-        for(const auto& file_range :
-            all_of(posix_file::file{m_input_path, m_fs_i_type}) |
-                    as_blocks(m_block_size) |
-                    strided(m_workers_size, m_workers_rank)) {
-            if(index < ongoing_index) {
-                ++index;
-                continue;
-            } else {
-                if(index > ongoing_index) {
-                    return index;
-                }
-            }
-            // LOG indexes and sizes
-
-            assert(m_buffer_regions[index].size() >= file_range.size());
-
-            auto start = std::chrono::steady_clock::now();
-            m_output_file->pwrite(m_buffer_regions[index], file_range.offset(),
-                                  file_range.size());
-            // Do sleep
-            auto total_sleep = sleep_value();
-            auto small_sleep = total_sleep / 100;
-            if(small_sleep == std::chrono::milliseconds(0))
-                small_sleep = std::chrono::milliseconds(1);
-            while(total_sleep > std::chrono::milliseconds(0)) {
-                std::this_thread::sleep_for(small_sleep);
-                total_sleep -= small_sleep;
-                if(total_sleep > sleep_value()) {
-                    break;
-                }
+
+        if(throttled()) {
+            return ongoing_index;
+        }
+
+        // all the blocks from the previous round have been written, fetch
+        // the next ones
+        while(static_cast<std::size_t>(ongoing_index) == m_blocks_read &&
+              m_round < m_rounds) {
+            read_round();
+        }
+
+        if(static_cast<std::size_t>(ongoing_index) < m_plan.size()) {
+            // blocks complete in order, so that `ongoing_index` is always
+            // the number of blocks already written
+            const std::size_t n = m_writes.pop();
+            consume(n);
+            account(n);
+
+            if(verify()) {
+                const auto k = static_cast<std::size_t>(ongoing_index);
+                m_digest.add(m_plan[k], m_checksums[k % m_blocks_per_round]);
             }
-            auto end = std::chrono::steady_clock::now();
-            // Send transfer bw
-            double elapsed_seconds =
-                    std::chrono::duration_cast<std::chrono::duration<double>>(
-                            end - start)
-                            .count();
-            if((elapsed_seconds) > 0) {
-                bw((m_block_size / (1024.0 * 1024.0)) / (elapsed_seconds));
-                LOGGER_DEBUG(
-                        "BW (write) Update: {} / {} = {} mb/s [ Sleep {} ]",
-                        m_block_size / 1024.0, elapsed_seconds, bw(),
-                        sleep_value());
+
+            if(static_cast<std::size_t>(ongoing_index) + 1 < m_plan.size()) {
+                return ongoing_index + 1;
             }
+        }
 
-            ++index;
+        // this rank has no more blocks, but other ranks may still need it
+        // for their remaining collective rounds
+        while(m_round < m_rounds) {
+            read_round();
         }
     } catch(const mpioxx::io_error& e) {
         LOGGER_ERROR("{}() failed: {}", e.where(), e.what());
         m_status = make_mpi_error(e.error_code());
+        abandon_rounds();
         return -1;
     } catch(const posix_file::io_error& e) {
         LOGGER_ERROR("{}() failed: {}", e.where(), e.what());
         m_status = make_system_error(e.error_code());
+        abandon_rounds();
         return -1;
     } catch(const std::system_error& e) {
         LOGGER_ERROR("Unexpected system error: {}", e.what());
         m_status = make_system_error(e.code().value());
+        abandon_rounds();
         return -1;
     } catch(const std::exception& e) {
         LOGGER_ERROR("Progress: Unexpected exception: {}", e.what());
         m_status = error_code::other;
+        abandon_rounds();
         return -1;
     }
 
+    if(incremental()) {
+        LOGGER_INFO("{} of {} blocks of {} were unchanged", m_unchanged.load(),
+                    m_plan.size(), m_output_path.string());
+    }
+
     m_status = error_code::success;
     m_output_file->close();
+    m_input_file.reset();
     return -1;
 }
 
@@ -247,4 +361,9 @@ mpio_read::progress() const {
     return m_status;
 }
 
+std::optional<std::uint32_t>
+mpio_read::checksum() const {
+    return verify() ? std::optional{m_digest.value()} : std::nullopt;
+}
+
 } // namespace cargo
\ No newline at end of file
@@ -25,10 +25,14 @@
 #ifndef CARGO_WORKER_MPIO_READ_HPP
 #define CARGO_WORKER_MPIO_READ_HPP
 
+#include <atomic>
 #include "ops.hpp"
 #include "memory.hpp"
+#include "mpioxx.hpp"
 #include <posix_file/file.hpp>
 #include <posix_file/views.hpp>
+#include <posix_file/block_plan.hpp>
+#include <posix_file/checksum.hpp>
 
 namespace mpi = boost::mpi;
 
@@ -50,6 +54,9 @@ public:
     int
     progress(int ongoing_index) final;
 
+    std::optional<std::uint32_t>
+    checksum() const final;
+
     std::string
     output_path() const {
         return m_output_path;
@@ -61,19 +68,55 @@ public:
     }
 
 private:
+    // Run the next collective read round, filling the buffer with the
+    // following `m_blocks_per_round` blocks assigned to this rank, and
+    // start writing them to the output file
+    void
+    read_round();
+
+    // Take part in the remaining collective rounds with no blocks after a
+    // local failure, so that the other ranks do not wait for this one
+    void
+    abandon_rounds() noexcept;
+
     mpi::communicator m_workers;
     cargo::error_code m_status;
     std::filesystem::path m_input_path{};
     std::filesystem::path m_output_path{};
+    std::unique_ptr<mpioxx::file> m_input_file;
     std::unique_ptr<posix_file::file> m_output_file;
+    // the block and file types of the view of the input file
+    std::shared_ptr<const block_layout> m_layout;
     int m_workers_size;
     int m_workers_rank;
     std::size_t m_block_size;
     memory_buffer m_buffer;
     std::vector<buffer_region> m_buffer_regions;
+    // Blocks read back from the output file in incremental or verify mode,
+    // and the number of them found unchanged
+    memory_buffer m_output_buffer;
+    std::atomic<std::size_t> m_unchanged = 0;
+    // Checksum of the block in each buffer region, and digest of the blocks
+    // written so far, in verify mode
+    std::vector<std::uint32_t> m_checksums;
+    posix_file::file_digest m_digest;
+    // Blocks this rank is responsible for
+    posix_file::block_plan m_plan;
+    // Blocks that fit in the buffer in a single round
+    std::size_t m_blocks_per_round;
+    // Blocks read so far (over all rounds)
+    std::size_t m_blocks_read;
+    std::size_t m_rounds = 0;
+    std::size_t m_round = 0;
     std::uint64_t m_kb_size;
     FSPlugin::type m_fs_i_type;
     FSPlugin::type m_fs_o_type;
+    // Queue for the block I/O on the local file (nullptr if the I/O pool
+    // is used instead)
+    std::shared_ptr<posix_file::io_queue> m_io_queue;
+    // Pending block writes. Declared last so that they are waited for
+    // before the buffer and the output file are released
+    completion_queue m_writes;
 };
 
 } // namespace cargo
@@ -27,6 +27,7 @@
 #include "mpioxx.hpp"
 
 #include <thread>
+#include <algorithm>
 namespace cargo {
 
 cargo::error_code
@@ -54,46 +55,101 @@ mpio_write::operator()() {
             ++total_blocks;
         }
 
-        // find how many blocks this rank is responsible for
-        std::size_t blocks_per_rank = total_blocks / workers_size;
-
-        if(int64_t n = total_blocks % workers_size;
-           n != 0 && workers_rank < n) {
-            ++blocks_per_rank;
+        // find which blocks this rank is responsible for
+        m_plan = posix_file::block_plan{static_cast<std::size_t>(file_size),
+                                        block_size,
+                                        static_cast<std::size_t>(workers_size),
+                                        static_cast<std::size_t>(workers_rank)};
+        const std::size_t blocks_per_rank = m_plan.size();
+        m_extents = m_input_file->extents();
+
+        // The collective write is split in rounds so that the memory used by
+        // each rank is bounded. All ranks must take part in every round, so
+        // the number of rounds is derived from the largest share of blocks,
+        // which is the same for all of them
+        const std::size_t max_blocks_per_rank =
+                (total_blocks + workers_size - 1) / workers_size;
+        const std::size_t blocks_per_round =
+                operation::blocks_per_round(block_size);
+
+        m_rounds = (max_blocks_per_rank + blocks_per_round - 1) /
+                   blocks_per_round;
+        m_round = 0;
+        m_round_bytes = 0;
+
+        // step 1. acquire buffers (enough for a single round)
+        const std::size_t buffered_blocks =
+                std::min(blocks_per_rank, blocks_per_round);
+
+        m_buffer.resize(buffered_blocks * block_size);
+        m_buffer_regions.reserve(buffered_blocks);
+
+        for(std::size_t i = 0; i < buffered_blocks; ++i) {
+            m_buffer_regions.emplace_back(m_buffer.data() + i * block_size,
+                                          block_size);
         }
 
-        // step 1. acquire buffers
+        if(verify()) {
+            m_checksums.assign(buffered_blocks, 0);
+            m_digest = posix_file::file_digest{file_size};
+        }
 
-        m_buffer.resize(blocks_per_rank * block_size);
-        m_buffer_regions.reserve(blocks_per_rank);
+        m_io_queue =
+                make_io_queue(std::min(buffered_blocks, pipeline_depth()));
 
-        for(std::size_t i = 0; i < blocks_per_rank; ++i) {
-            m_buffer_regions.emplace_back(m_buffer.data() + i * block_size,
-                                          block_size);
+        if(m_io_queue) {
+            m_io_queue->register_buffer(m_buffer);
         }
 
+        // step 2. open the output file in the PFS so that each round
+        // can be written in parallel as soon as it is buffered
+        // all ranks get the same hints, as required by the collective open
+        const mpioxx::info hints{mpio_hints()};
+
+        m_output_file = std::make_unique<mpioxx::file>(mpioxx::file::open(
+                m_workers, m_output_path,
+                mpioxx::file_open_mode::create | mpioxx::file_open_mode::wronly,
+                hints));
+
+        // the block and file types are shared with other files of the same
+        // geometry
+        m_layout = datatypes()->get(block_size, total_blocks, workers_size);
+
+        if(const auto ec = MPI_File_set_view(
+                   *m_output_file,
+                   /* disp: */ workers_rank * block_size,
+                   /* elementary_type: */ m_layout->block_type,
+                   m_layout->file_type, "native", hints);
+           ec != MPI_SUCCESS) {
+            throw mpioxx::io_error("MPI_File_set_view", ec);
+        }
 
         m_workers_size = workers_size;
         m_workers_rank = workers_rank;
         m_block_size = block_size;
         m_file_size = file_size;
         m_total_blocks = total_blocks;
+        m_blocks_per_round = blocks_per_round;
 
     } catch(const mpioxx::io_error& e) {
         LOGGER_ERROR("{}() failed: {}", e.where(), e.what());
         m_status = make_mpi_error(e.error_code());
+        abandon_rounds();
         return make_mpi_error(e.error_code());
     } catch(const posix_file::io_error& e) {
         LOGGER_ERROR("{}() failed: {}", e.where(), e.what());
         m_status = make_system_error(e.error_code());
+        abandon_rounds();
         return make_system_error(e.error_code());
     } catch(const std::system_error& e) {
         LOGGER_ERROR("Unexpected system error: {}", e.what());
         m_status = make_system_error(e.code().value());
+        abandon_rounds();
         return make_system_error(e.code().value());
     } catch(const std::exception& e) {
         LOGGER_ERROR("Unexpected exception: {}", e.what());
         m_status = error_code::other;
+        abandon_rounds();
         return error_code::other;
     }
 
@@ -104,137 +160,176 @@ mpio_write::progress() const {
     return m_status;
 }
 
-int
-mpio_write::progress(int ongoing_index) {
-    using posix_file::views::all_of;
-    using posix_file::views::as_blocks;
-    using posix_file::views::strided;
+std::optional<std::uint32_t>
+mpio_write::checksum() const {
+    return verify() ? std::optional{m_digest.value()} : std::nullopt;
+}
+
+void
+mpio_write::read_round() {
+
+    const std::size_t round_start = m_round * m_blocks_per_round;
+    const std::size_t round_end =
+            std::min(round_start + m_blocks_per_round, m_plan.size());
+
+    const bool queued =
+            m_io_queue && m_io_queue->async(*m_input_file) && !verify();
+
+    for(std::size_t k = round_start; k < round_end; ++k) {
+        const auto range = m_plan[k];
+        const std::size_t slot = k - round_start;
+        const auto region = m_buffer_regions[slot];
+
+        assert(region.size() >= range.size());
+
+        // holes are written as zeros, but there is no need to read them
+        if(!m_extents.data_in(range)) {
+            std::fill_n(region.begin(), range.size(), 0);
+            m_reads.push_ready(range.size());
+
+            if(verify()) {
+                m_digest.add_zeros(range);
+            }
+            continue;
+        }
+
+        if(verify()) {
+            m_reads.push(pool()->submit([this, slot, region, range] {
+                const std::size_t n = m_input_file->pread(
+                        region, range.offset(), range.size());
+                m_checksums[slot] =
+                        posix_file::crc32c(0, region.data(), range.size());
+                return n;
+            }));
+            continue;
+        }
+
+        if(queued) {
+            m_reads.push(*m_io_queue,
+                         m_io_queue->read(*m_input_file, region,
+                                          range.offset(), range.size()));
+            continue;
+        }
+
+        m_reads.push(pool()->submit([this, region, range] {
+            return m_input_file->pread(region, range.offset(), range.size());
+        }));
+    }
+
+    if(queued) {
+        m_io_queue->submit();
+    }
+}
+
+void
+mpio_write::write_round() {
+
+    // ranks that have already written all their blocks still need to take
+    // part in the collective call, albeit with an empty request
+    const auto ec = MPI_File_write_all(*m_output_file, m_buffer.data(),
+                                       static_cast<int>(m_round_bytes),
+                                       MPI_BYTE, MPI_STATUS_IGNORE);
+
+    // this rank took part in the round even if it failed
+    m_round_bytes = 0;
+    ++m_round;
+
+    if(ec != MPI_SUCCESS) {
+        throw mpioxx::io_error("MPI_File_write_all", ec);
+    }
+}
+
+void
+mpio_write::abandon_rounds() noexcept {
 
-    // compute the number of blocks in the file
+    // the other ranks block in their collective calls until this rank
+    // has taken part in all the rounds, so do so with empty requests
+    // the output file is opened once the local setup has succeeded
+    if(!m_output_file) {
+        return;
+    }
 
-    int index = 0;
-    if(ongoing_index == 0) {
-        m_bytes_per_rank = 0;
+    for(; m_round < m_rounds; ++m_round) {
+        MPI_File_write_all(*m_output_file, m_buffer.data(), 0, MPI_BYTE,
+                           MPI_STATUS_IGNORE);
     }
+}
+
+int
+mpio_write::progress(int ongoing_index) {
+
+    int index = ongoing_index;
     try {
-        for(const auto& file_range :
-            all_of(*m_input_file) | as_blocks(m_block_size) |
-                    strided(m_workers_size, m_workers_rank)) {
-
-            if(index < ongoing_index) {
-                ++index;
-                continue;
-            } else {
-                if(index > ongoing_index) {
-                    return index;
-                }
-            }
+        // blocks in [round_start, round_end) are buffered in this round
+        const std::size_t round_start = m_round * m_blocks_per_round;
+        const std::size_t round_end = std::min(
+                round_start + m_blocks_per_round, m_plan.size());
+
+        if(static_cast<std::size_t>(ongoing_index) < round_end) {
             m_status = error_code::transfer_in_progress;
-            assert(m_buffer_regions[index].size() >= file_range.size());
-            auto start = std::chrono::steady_clock::now();
-            const std::size_t n =
-                    m_input_file->pread(m_buffer_regions[index],
-                                        file_range.offset(), file_range.size());
 
-            LOGGER_DEBUG("Buffer contents: [\"{}\" ... \"{}\"]",
-                         fmt::join(buffer_regions[index].begin(),
-                                   buffer_regions[index].begin() + 10, ""),
-                         fmt::join(buffer_regions[index].end() - 10,
-                                   buffer_regions[index].end(), ""));
-
-
-            m_bytes_per_rank += n;
-            // Do sleep (But be a bit reactive...)
-            auto total_sleep = sleep_value();
-            auto small_sleep = total_sleep / 100;
-            if (small_sleep == std::chrono::milliseconds(0)) small_sleep = std::chrono::milliseconds(1);
-            while( total_sleep > std::chrono::milliseconds(0)) {
-                std::this_thread::sleep_for(small_sleep);
-                total_sleep -= small_sleep;
-                if (total_sleep > sleep_value()) {
-                    break;
-                }
+            if(throttled()) {
+                return ongoing_index;
             }
-            
-            auto end = std::chrono::steady_clock::now();
-            // Send transfer bw
-            double elapsed_seconds =
-                    std::chrono::duration_cast<std::chrono::duration<double>>(
-                            end - start)
-                            .count();
-            if((elapsed_seconds) > 0) {
-                bw((m_block_size / (1024.0 * 1024.0)) / (elapsed_seconds));
-                LOGGER_DEBUG("BW (read) Update: {} / {} = {} mb/s [ Sleep {} ]",
-                             m_block_size / 1024.0, elapsed_seconds, bw(),
-                             sleep_value());
+
+            // the reads for the whole round are started at once and
+            // accounted for in order
+            if(static_cast<std::size_t>(ongoing_index) == round_start) {
+                read_round();
+            }
+
+            [[maybe_unused]] const auto& region =
+                    m_buffer_regions[index - round_start];
+
+            const std::size_t n = m_reads.pop();
+
+            LOGGER_DEBUG("Buffer contents: [\"{}\" ... \"{}\"]",
+                         fmt::join(region.begin(), region.begin() + 10, ""),
+                         fmt::join(region.end() - 10, region.end(), ""));
+
+            m_round_bytes += n;
+            consume(n);
+            account(n);
+
+            // holes were added to the digest when the round started
+            if(verify() && m_extents.data_in(m_plan[index])) {
+                m_digest.add(m_plan[index], m_checksums[index - round_start]);
             }
 
             ++index;
-        }
 
-        // step 2. write buffer data in parallel to the PFS
-        const auto output_file =
-                mpioxx::file::open(m_workers, m_output_path,
-                                   mpioxx::file_open_mode::create |
-                                           mpioxx::file_open_mode::wronly);
-
-        // create block type
-        MPI_Datatype block_type;
-        MPI_Type_contiguous(static_cast<int>(m_block_size), MPI_BYTE,
-                            &block_type);
-        MPI_Type_commit(&block_type);
-
-        // create file type
-        MPI_Datatype file_type;
-
-        /*
-         * count: number of blocks in the type
-         * blocklen: number of `oldtype` elements in each block
-         * stride: number of `oldtype` elements between start of each block
-         */
-        MPI_Type_vector(/* count: */ m_total_blocks, /* blocklength: */ 1,
-                        /* stride: */ m_workers_size, /* oldtype: */ block_type,
-                        &file_type);
-        MPI_Type_commit(&file_type);
-
-        if(const auto ec =
-                   MPI_File_set_view(output_file,
-                                     /* disp: */ m_workers_rank * m_block_size,
-                                     /* elementary_type: */ block_type,
-                                     file_type, "native", MPI_INFO_NULL);
-           ec != MPI_SUCCESS) {
-            LOGGER_ERROR("MPI_File_set_view() failed: {}",
-                         mpi::error_string(ec));
-            m_status = make_mpi_error(ec);
-            return -1;
+            if(static_cast<std::size_t>(index) < round_end) {
+                return index;
+            }
         }
 
-        // step 3. parallel write data from buffers
-        if(const auto ec =
-                   MPI_File_write_all(output_file, m_buffer.data(),
-                                      static_cast<int>(m_bytes_per_rank),
-                                      MPI_BYTE, MPI_STATUS_IGNORE);
-           ec != MPI_SUCCESS) {
-            LOGGER_ERROR("MPI_File_write_all() failed: {}",
-                         mpi::error_string(ec));
-            m_status = make_mpi_error(ec);
-            return -1;
+        // step 3. parallel write data from buffers once the round is complete
+        write_round();
+
+        if(m_round < m_rounds) {
+            return index;
         }
+
+        m_output_file.reset();
     } catch(const mpioxx::io_error& e) {
         LOGGER_ERROR("{}() failed: {}", e.where(), e.what());
         m_status = make_mpi_error(e.error_code());
+        abandon_rounds();
         return -1;
     } catch(const posix_file::io_error& e) {
         LOGGER_ERROR("{}() failed: {}", e.where(), e.what());
         m_status = make_system_error(e.error_code());
+        abandon_rounds();
         return -1;
     } catch(const std::system_error& e) {
         LOGGER_ERROR("Unexpected system error: {}", e.what());
         m_status = make_system_error(e.code().value());
+        abandon_rounds();
         return -1;
     } catch(const std::exception& e) {
         LOGGER_ERROR("Unexpected exception: {}", e.what());
         m_status = error_code::other;
+        abandon_rounds();
         return -1;
     }
 
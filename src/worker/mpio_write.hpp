@@ -27,8 +27,11 @@
 
 #include <posix_file/file.hpp>
 #include <posix_file/views.hpp>
+#include <posix_file/block_plan.hpp>
+#include <posix_file/checksum.hpp>
 #include "ops.hpp"
 #include "memory.hpp"
+#include "mpioxx.hpp"
 
 namespace mpi = boost::mpi;
 
@@ -54,6 +57,9 @@ public:
     int
     progress(int ongoing_index) final;
 
+    std::optional<std::uint32_t>
+    checksum() const final;
+
     std::string
     output_path() const {
         return m_output_path;
@@ -66,12 +72,28 @@ public:
 
 
 private:
+    // Start reading the blocks of the current round into the buffer
+    void
+    read_round();
+
+    // Collectively write the blocks buffered in the current round
+    void
+    write_round();
+
+    // Take part in the remaining collective rounds with no blocks after a
+    // local failure, so that the other ranks do not wait for this one
+    void
+    abandon_rounds() noexcept;
+
     mpi::communicator m_workers;
     cargo::error_code m_status;
     std::filesystem::path m_input_path{};
     std::filesystem::path m_output_path{};
 
     std::unique_ptr<posix_file::file> m_input_file;
+    std::unique_ptr<mpioxx::file> m_output_file;
+    // the block and file types of the view of the output file
+    std::shared_ptr<const block_layout> m_layout;
     int m_workers_size;
     int m_workers_rank;
     std::size_t m_block_size;
@@ -80,10 +102,29 @@ private:
 
     memory_buffer m_buffer;
     std::vector<buffer_region> m_buffer_regions;
-    std::size_t m_bytes_per_rank;
+    // Blocks this rank is responsible for
+    posix_file::block_plan m_plan;
+    // Data extents of the input file: blocks in its holes need not be read
+    posix_file::extent_map m_extents;
+    // Checksum of the block in each buffer region, and digest of the blocks
+    // written so far, in verify mode. The output file is not read back
+    std::vector<std::uint32_t> m_checksums;
+    posix_file::file_digest m_digest;
+    // Blocks that fit in the buffer in a single round
+    std::size_t m_blocks_per_round;
+    // Bytes buffered in the current round
+    std::size_t m_round_bytes;
+    std::size_t m_rounds = 0;
+    std::size_t m_round = 0;
     std::uint64_t m_kb_size;
     FSPlugin::type m_fs_i_type;
     FSPlugin::type m_fs_o_type;
+    // Queue for the block I/O on the local file (nullptr if the I/O pool
+    // is used instead)
+    std::shared_ptr<posix_file::io_queue> m_io_queue;
+    // Pending block reads. Declared last so that they are waited for
+    // before the buffer and the input file are released
+    completion_queue m_reads;
 };
 
 } // namespace cargo
@@ -27,6 +27,9 @@
 #include "mpio_write.hpp"
 #include "sequential.hpp"
 #include "seq_mixed.hpp"
+#include "fmt_formatters.hpp"
+#include <limits>
+#include <mutex>
 
 namespace mpi = boost::mpi;
 
@@ -73,6 +76,234 @@ operation::sleep_value() const {
 void
 operation::set_bw_shaping(std::int16_t incr) {
     m_sleep_value += incr;
+
+    // apply a lower shaping value right away
+    m_resume_at = std::min(m_resume_at,
+                           std::chrono::steady_clock::now() + sleep_value());
+}
+
+void
+operation::set_rate_limiter(std::shared_ptr<token_bucket> limiter) {
+    m_rate_limiter = std::move(limiter);
+}
+
+bool
+operation::throttled() {
+    return throttle_delay() != std::chrono::nanoseconds::zero();
+}
+
+std::chrono::nanoseconds
+operation::throttle_delay() {
+
+    const auto now = std::chrono::steady_clock::now();
+    auto delay = std::chrono::nanoseconds::zero();
+
+    if(m_resume_at > now) {
+        delay = m_resume_at - now;
+    }
+
+    if(m_rate_limiter) {
+        delay = std::max(delay, m_rate_limiter->delay());
+    }
+
+    return delay;
+}
+
+void
+operation::consume(std::size_t bytes) {
+    if(m_rate_limiter) {
+        m_rate_limiter->consume(bytes);
+    }
+}
+
+void
+operation::account(std::size_t bytes) {
+
+    const auto now = std::chrono::steady_clock::now();
+    const double elapsed_seconds =
+            std::chrono::duration<double>(now - m_last_block).count();
+
+    m_last_block = now;
+    m_resume_at = now + sleep_value();
+
+    // Send transfer bw
+    if(elapsed_seconds > 0) {
+        bw(static_cast<float_t>((bytes / (1024.0 * 1024.0)) / elapsed_seconds));
+        LOGGER_DEBUG("BW Update: {} / {} = {} mb/s [ Sleep {} ]",
+                     bytes / 1024.0, elapsed_seconds, bw(), sleep_value());
+    }
+}
+
+std::uint64_t
+operation::memory_limit() const {
+    return m_memory_limit;
+}
+
+void
+operation::set_memory_limit(std::uint64_t limit) {
+    m_memory_limit = limit;
+}
+
+std::size_t
+operation::blocks_per_round(std::size_t block_size) const {
+
+    std::size_t max_blocks = std::numeric_limits<int>::max() / block_size;
+
+    if(m_memory_limit != 0) {
+        max_blocks = std::min<std::size_t>(max_blocks,
+                                           m_memory_limit / block_size);
+    }
+
+    return std::max<std::size_t>(max_blocks, 1);
+}
+
+std::size_t
+operation::pipeline_depth() const {
+    return m_pipeline_depth;
+}
+
+void
+operation::set_pipeline_depth(std::size_t depth) {
+    m_pipeline_depth = std::max<std::size_t>(depth, 1);
+}
+
+std::shared_ptr<io_pool>
+operation::pool() const {
+    assert(m_io_pool);
+    return m_io_pool;
+}
+
+void
+operation::set_io_pool(std::shared_ptr<io_pool> pool) {
+    m_io_pool = std::move(pool);
+}
+
+std::shared_ptr<datatype_cache>
+operation::datatypes() const {
+    assert(m_datatypes);
+    return m_datatypes;
+}
+
+void
+operation::set_datatype_cache(std::shared_ptr<datatype_cache> cache) {
+    m_datatypes = std::move(cache);
+}
+
+void
+operation::set_status_reporter(std::shared_ptr<status_reporter> reporter) {
+    m_status_reporter = std::move(reporter);
+}
+
+bool
+operation::io_uring() const {
+    return m_io_uring;
+}
+
+void
+operation::set_io_uring(bool enable) {
+    m_io_uring = enable;
+}
+
+bool
+operation::incremental() const {
+    return m_incremental;
+}
+
+void
+operation::set_incremental(bool enable) {
+    m_incremental = enable;
+}
+
+bool
+operation::verify() const {
+    return m_verify;
+}
+
+void
+operation::set_verify(bool enable) {
+    m_verify = enable;
+}
+
+bool
+operation::compression() const {
+    return m_compression;
+}
+
+void
+operation::set_compression(bool enable) {
+    m_compression = enable;
+}
+
+const std::filesystem::path&
+operation::journal_dir() const {
+    return m_journal_dir;
+}
+
+void
+operation::set_journal_dir(std::filesystem::path dir) {
+    m_journal_dir = std::move(dir);
+}
+
+const cargo::mpio_hints&
+operation::mpio_hints() const {
+    return m_mpio_hints;
+}
+
+void
+operation::set_mpio_hints(cargo::mpio_hints hints) {
+    m_mpio_hints = std::move(hints);
+}
+
+std::optional<std::uint32_t>
+operation::checksum() const {
+    return std::nullopt;
+}
+
+std::shared_ptr<posix_file::io_queue>
+operation::make_io_queue(std::size_t depth) const {
+
+    if(!m_io_uring) {
+        return {};
+    }
+
+    auto queue = std::make_shared<posix_file::io_queue>(
+            static_cast<unsigned int>(std::min<std::size_t>(
+                    depth, std::numeric_limits<unsigned int>::max())));
+
+    if(!queue->async()) {
+        static std::once_flag warned;
+        std::call_once(warned, [] {
+            LOGGER_WARN("io_uring is not available, using I/O threads");
+        });
+        return {};
+    }
+
+    return queue;
+}
+
+std::uint64_t
+operation::chunk_blocks() const {
+    return m_chunk_blocks;
+}
+
+void
+operation::set_chunk_blocks(std::uint64_t chunk_blocks) {
+    m_chunk_blocks = chunk_blocks;
+}
+
+void
+operation::grant_blocks(std::uint64_t first, std::uint64_t count) {
+    LOGGER_WARN("Unexpected grant of {} blocks from {} for {}", count, first,
+                output_path());
+}
+
+void
+operation::request_blocks() {
+
+    mpi::communicator world;
+    const claim_message m{m_tid, m_seqno};
+    LOGGER_DEBUG("msg <= to: {} body: {{payload: {}}}", m_rank, m);
+    world.send(m_rank, static_cast<int>(tag::claim), m);
 }
 
 int
@@ -93,6 +324,29 @@ operation::t() {
     return m_t;
 }
 
+bool
+operation::collective() const {
+    return m_t == tag::pread || m_t == tag::pwrite;
+}
+
+void
+operation::update_state(transfer_state st, float bw,
+                        std::optional<error_code> ec) {
+
+    status_message m{
+            m_tid, m_seqno, output_path(), st, bw, ec,
+            st == transfer_state::completed ? checksum() : std::nullopt};
+
+    if(m_status_reporter) {
+        m_status_reporter->report(m_rank, std::move(m));
+        return;
+    }
+
+    mpi::communicator world;
+    LOGGER_DEBUG("msg <= to: {} body: {{payload: {}}}", m_rank, m);
+    world.send(m_rank, static_cast<int>(tag::status), m);
+}
+
 float_t
 operation::bw() {
     return m_bw;
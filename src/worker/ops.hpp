@@ -31,6 +31,10 @@
 #include "proto/mpi/message.hpp"
 #include "cargo.hpp"
 #include "posix_file/file.hpp"
+#include "io_pool.hpp"
+#include "datatype_cache.hpp"
+#include "status_reporter.hpp"
+#include "token_bucket.hpp"
 namespace cargo {
 
 /**
@@ -53,9 +57,127 @@ public:
 
     std::chrono::milliseconds
     sleep_value() const;
+
+    // Maximum number of bytes that an operation may keep buffered at once
+    // (0 means no limit)
+    std::uint64_t
+    memory_limit() const;
+    void
+    set_memory_limit(std::uint64_t limit);
+
+    // Number of `block_size` blocks that can be buffered under the memory
+    // limit, also capped so that a single MPI call never overflows its
+    // `int` count
+    std::size_t
+    blocks_per_round(std::size_t block_size) const;
+
+    // Maximum number of blocks that an operation keeps in flight in its
+    // I/O pool
+    std::size_t
+    pipeline_depth() const;
+    void
+    set_pipeline_depth(std::size_t depth);
+
+    // The pool of I/O threads shared by all operations of a worker
+    std::shared_ptr<io_pool>
+    pool() const;
+    void
+    set_io_pool(std::shared_ptr<io_pool> pool);
+
+    // The MPI datatypes shared by the collective operations of a worker
+    std::shared_ptr<datatype_cache>
+    datatypes() const;
+    void
+    set_datatype_cache(std::shared_ptr<datatype_cache> cache);
+
+    // The reporter that coalesces the status updates of the operations of a
+    // worker. Updates are sent right away if there is none
+    void
+    set_status_reporter(std::shared_ptr<status_reporter> reporter);
+
+    // Whether block I/O on local files may be driven through io_uring
+    bool
+    io_uring() const;
+    void
+    set_io_uring(bool enable);
+
+    // Whether only the blocks that differ from those already in the output
+    // file are written
+    bool
+    incremental() const;
+    void
+    set_incremental(bool enable);
+
+    // Whether each block written is read back from the output file and
+    // checked against the checksum of the input block
+    bool
+    verify() const;
+    void
+    set_verify(bool enable);
+
+    // Whether sequential transfers from an ad-hoc file system to a POSIX
+    // dataset are stored as block-compressed containers, and containers
+    // found on input are decompressed
+    bool
+    compression() const;
+    void
+    set_compression(bool enable);
+
+    // Directory where the blocks completed in each output file are journaled,
+    // so that an interrupted transfer can skip them when resumed. Journaling
+    // is disabled if it is empty
+    const std::filesystem::path&
+    journal_dir() const;
+    void
+    set_journal_dir(std::filesystem::path dir);
+
+    // Hints passed to MPI-IO by the operations that open their files
+    // collectively
+    const cargo::mpio_hints&
+    mpio_hints() const;
+    void
+    set_mpio_hints(cargo::mpio_hints hints);
+
+    // The digest of the data transferred by this worker, once the operation
+    // has completed, if it checksums the blocks that it transfers
+    virtual std::optional<std::uint32_t>
+    checksum() const;
+
+    // Create a queue for up to `depth` asynchronous block requests, or
+    // return nullptr if io_uring is disabled or not supported by the kernel,
+    // in which case the I/O pool should be used instead
+    std::shared_ptr<posix_file::io_queue>
+    make_io_queue(std::size_t depth) const;
+
+    // Number of blocks per chunk if the master hands out the blocks of the
+    // file on demand, or 0 if each worker transfers a fixed share of them
+    std::uint64_t
+    chunk_blocks() const;
+    void
+    set_chunk_blocks(std::uint64_t chunk_blocks);
+
+    // Add the `count` blocks from `first` granted by the master in reply to
+    // a claim (0 blocks means that the file has no blocks left)
+    virtual void
+    grant_blocks(std::uint64_t first, std::uint64_t count);
+
     // We pass a - or + value to decrease or increase the bw shaping.
     void
     set_bw_shaping(std::int16_t incr);
+
+    // The token bucket that limits the rate of this operation. It is shared
+    // by all the operations of the same transfer in a worker
+    void
+    set_rate_limiter(std::shared_ptr<token_bucket> limiter);
+
+    // Whether the operation must wait before moving more data, either because
+    // of its rate limit or of its bw shaping
+    bool
+    throttled();
+
+    // Time left until the operation is no longer throttled
+    std::chrono::nanoseconds
+    throttle_delay();
     virtual cargo::error_code
     progress() const = 0;
     virtual int
@@ -73,20 +195,62 @@ public:
     cargo::tag
     t();
 
+    // Whether the operation issues MPI collective calls, which requires all
+    // workers to progress it in the same order with respect to other
+    // collective operations
+    bool
+    collective() const;
+
     float_t
     bw();
     void
     bw(float_t bw);
 
+    // Report the state of the operation to the master. Operations that
+    // transfer several files may report them in aggregate
+    virtual void
+    update_state(transfer_state st, float bw,
+                 std::optional<error_code> ec = std::nullopt);
+
     virtual std::string
     output_path() const = 0;
 
     virtual std::string
     input_path() const = 0;
 
+protected:
+    // Charge `bytes` that are about to be transferred to the rate limit
+    void
+    consume(std::size_t bytes);
+
+    // Account for a block of `bytes` that has been transferred: update the
+    // bw estimate and apply the bw shaping delay
+    void
+    account(std::size_t bytes);
+
+    // Claim the next chunk of blocks of the file from the master
+    void
+    request_blocks();
 
 private:
     std::int16_t m_sleep_value = 0;
+    std::shared_ptr<token_bucket> m_rate_limiter;
+    // the operation is throttled by bw shaping until this time
+    std::chrono::steady_clock::time_point m_resume_at;
+    std::chrono::steady_clock::time_point m_last_block =
+            std::chrono::steady_clock::now();
+    std::uint64_t m_memory_limit = 0;
+    std::size_t m_pipeline_depth = 4;
+    std::shared_ptr<io_pool> m_io_pool;
+    std::shared_ptr<datatype_cache> m_datatypes;
+    std::shared_ptr<status_reporter> m_status_reporter;
+    bool m_io_uring = true;
+    bool m_incremental = false;
+    bool m_verify = false;
+    bool m_compression = false;
+    std::filesystem::path m_journal_dir;
+    cargo::mpio_hints m_mpio_hints;
+    std::uint64_t m_chunk_blocks = 0;
     int m_rank;
     std::uint64_t m_tid;
     std::uint32_t m_seqno;
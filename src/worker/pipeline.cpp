@@ -0,0 +1,361 @@
+/******************************************************************************
+ * Copyright 2022-2023, Barcelona Supercomputing Center (BSC), Spain
+ *
+ * This software was partially supported by the EuroHPC-funded project ADMIRE
+ *   (Project ID: 956748, https://www.admire-eurohpc.eu).
+ *
+ * This file is part of Cargo.
+ *
+ * Cargo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cargo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cargo.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *****************************************************************************/
+
+
+#include "pipeline.hpp"
+#include <cassert>
+#include <cstring>
+
+namespace cargo {
+
+bool
+write_if_changed(const posix_file::file& out, buffer_region region,
+                 buffer_region current, posix_file::ranges::range range) {
+
+    // comparing the blocks directly is cheaper than hashing both of them,
+    // since they are in memory anyway. The output file may also be shorter
+    // than the block
+    if(out.pread(current, range.offset(), range.size()) == range.size() &&
+       std::memcmp(region.data(), current.data(), range.size()) == 0) {
+        return false;
+    }
+
+    out.pwrite(region, range.offset(), range.size());
+    return true;
+}
+
+void
+check_written(const posix_file::file& out, buffer_region current,
+              posix_file::ranges::range range, std::uint32_t crc) {
+
+    if(out.pread(current, range.offset(), range.size()) != range.size() ||
+       posix_file::crc32c(0, current.data(), range.size()) != crc) {
+        throw posix_file::io_error("check_written", EIO);
+    }
+}
+
+block_pipeline::block_pipeline(std::shared_ptr<io_pool> pool,
+                               std::size_t depth, std::size_t block_size,
+                               std::shared_ptr<posix_file::io_queue> queue)
+    : m_pool(std::move(pool)), m_queue(std::move(queue)),
+      m_buffer(depth * block_size) {
+
+    m_regions.reserve(depth);
+
+    for(std::size_t i = 0; i < depth; ++i) {
+        m_regions.emplace_back(m_buffer.data() + i * block_size, block_size);
+    }
+
+    if(m_queue) {
+        m_queue->register_buffer(m_buffer);
+    }
+}
+
+void
+block_pipeline::enable_verification() {
+    m_verify = true;
+    m_slot_checksums.assign(depth(), 0);
+}
+
+buffer_region
+block_pipeline::output_region(std::size_t slot) {
+
+    if(m_output_regions.empty()) {
+        m_output_buffer.resize(m_buffer.size());
+        m_output_regions.reserve(m_regions.size());
+
+        for(std::size_t i = 0; i < m_regions.size(); ++i) {
+            m_output_regions.emplace_back(
+                    m_output_buffer.data() + i * block_size(), block_size());
+        }
+    }
+
+    return m_output_regions[slot];
+}
+
+std::size_t
+block_pipeline::depth() const noexcept {
+    return m_regions.size();
+}
+
+std::size_t
+block_pipeline::block_size() const noexcept {
+    return m_regions.front().size();
+}
+
+std::size_t
+block_pipeline::issued() const noexcept {
+    return m_issued;
+}
+
+bool
+block_pipeline::empty() const noexcept {
+    return m_in_flight.empty();
+}
+
+bool
+block_pipeline::full() const noexcept {
+    return m_in_flight.size() >= m_regions.size();
+}
+
+void
+block_pipeline::issue(posix_file::ranges::range range, task t) {
+
+    assert(!full());
+
+    const std::size_t slot = m_issued % m_regions.size();
+    const buffer_region region = m_regions[slot];
+
+    assert(region.size() >= range.size());
+
+    m_completions.push(m_pool->submit(
+            [t = std::move(t), region, range] { return t(region, range); }));
+    m_in_flight.push_back(in_flight{slot, range});
+    ++m_issued;
+}
+
+void
+block_pipeline::issue_copy(const posix_file::file& in,
+                           const posix_file::file& out,
+                           posix_file::ranges::range range) {
+
+    using posix_file::kernel_copier;
+
+    if(m_verify) {
+        const std::size_t slot = m_issued % depth();
+        const buffer_region current = output_region(slot);
+
+        issue(range, [this, &in, &out, slot,
+                      current](buffer_region region,
+                               posix_file::ranges::range range) {
+            const std::size_t n =
+                    in.pread(region, range.offset(), range.size());
+
+            m_slot_checksums[slot] =
+                    posix_file::crc32c(0, region.data(), range.size());
+            out.pwrite(region, range.offset(), range.size());
+            check_written(out, current, range, m_slot_checksums[slot]);
+            return n;
+        });
+        return;
+    }
+
+    if(kernel_copier::supported(in, out) &&
+       m_copier.current() != kernel_copier::method::none) {
+        issue(range, [this, &in, &out](buffer_region region,
+                                       posix_file::ranges::range range) {
+            return m_copier.copy(in, out, region, range.offset(),
+                                 range.size());
+        });
+        return;
+    }
+
+    if(!m_queue || !m_queue->async(in) || !m_queue->async(out)) {
+        issue(range, [&in, &out](buffer_region region,
+                                 posix_file::ranges::range range) {
+            const std::size_t n = in.pread(region, range.offset(), range.size());
+            out.pwrite(region, range.offset(), range.size());
+            return n;
+        });
+        return;
+    }
+
+    assert(!full());
+
+    const std::size_t slot = m_issued % m_regions.size();
+    const buffer_region region = m_regions[slot];
+
+    assert(region.size() >= range.size());
+
+    m_completions.push(*m_queue, m_queue->copy(in, out, region, range.offset(),
+                                               range.size()));
+    m_in_flight.push_back(in_flight{slot, range});
+    ++m_issued;
+}
+
+void
+block_pipeline::issue_update(const posix_file::file& in,
+                             const posix_file::file& out,
+                             posix_file::ranges::range range) {
+
+    const std::size_t slot = m_issued % depth();
+    const buffer_region current = output_region(slot);
+
+    issue(range, [this, &in, &out, slot,
+                  current](buffer_region region,
+                           posix_file::ranges::range range) {
+        const std::size_t n = in.pread(region, range.offset(), range.size());
+
+        if(m_verify) {
+            m_slot_checksums[slot] =
+                    posix_file::crc32c(0, region.data(), range.size());
+        }
+
+        // an unchanged block has just been compared with the output file,
+        // so there is nothing left to verify
+        if(!write_if_changed(out, region, current, range)) {
+            m_unchanged.fetch_add(1, std::memory_order_relaxed);
+        } else if(m_verify) {
+            check_written(out, current, range, m_slot_checksums[slot]);
+        }
+        return n;
+    });
+}
+
+void
+block_pipeline::issue_compress(const posix_file::file& in,
+                               const posix_file::file& out,
+                               posix_file::block_container container,
+                               posix_file::ranges::range range, int level) {
+
+    const std::size_t slot = m_issued % depth();
+    const buffer_region packed = output_region(slot);
+
+    assert(packed.size() >= container.block_size());
+
+    issue(range, [this, &in, &out, slot, packed, container,
+                  level](buffer_region region,
+                         posix_file::ranges::range range) {
+        const std::size_t n = in.pread(region, range.offset(), range.size());
+
+        if(m_verify) {
+            m_slot_checksums[slot] =
+                    posix_file::crc32c(0, region.data(), range.size());
+        }
+
+        const std::size_t size =
+                container.pack(range, region.data(), packed.data(), level);
+        out.pwrite(packed, container.slot(range).offset(), size);
+        return n;
+    });
+}
+
+void
+block_pipeline::issue_decompress(const posix_file::file& in,
+                                 std::size_t in_size,
+                                 const posix_file::file& out,
+                                 posix_file::block_container container,
+                                 posix_file::ranges::range range) {
+
+    const std::size_t slot = m_issued % depth();
+    const buffer_region packed = output_region(slot);
+
+    assert(packed.size() >= container.block_size());
+
+    issue(range, [this, &in, in_size, &out, slot, packed,
+                  container](buffer_region region,
+                             posix_file::ranges::range range) {
+        // the unused tail of the last slot may be missing, but not the
+        // whole slot, unless the container was truncated
+        const auto s = container.slot(range);
+
+        if(static_cast<std::size_t>(s.offset()) >= in_size) {
+            throw posix_file::io_error("issue_decompress", EIO);
+        }
+
+        const std::size_t size = std::min<std::size_t>(
+                s.size(), in_size - static_cast<std::size_t>(s.offset()));
+
+        in.pread(packed, s.offset(), size);
+        container.unpack(range, packed.data(), size, region.data());
+
+        out.pwrite(region, range.offset(), range.size());
+
+        if(m_verify) {
+            m_slot_checksums[slot] =
+                    posix_file::crc32c(0, region.data(), range.size());
+            check_written(out, packed, range, m_slot_checksums[slot]);
+        }
+        return range.size();
+    });
+}
+
+std::size_t
+block_pipeline::unchanged() const noexcept {
+    return m_unchanged.load(std::memory_order_relaxed);
+}
+
+void
+block_pipeline::skip(posix_file::ranges::range range) {
+
+    assert(!full());
+
+    const std::size_t slot = m_issued % m_regions.size();
+
+    // the slot may still hold the checksum of an earlier block
+    if(m_verify) {
+        m_slot_checksums[slot] = 0;
+    }
+
+    m_completions.push_ready(0);
+    m_in_flight.push_back(in_flight{slot, range, true});
+    ++m_issued;
+}
+
+void
+block_pipeline::issue_resumed(const posix_file::file& out,
+                              posix_file::ranges::range range) {
+
+    if(!m_verify) {
+        skip(range);
+        return;
+    }
+
+    const std::size_t slot = m_issued % depth();
+
+    issue(range, [this, &out, slot](buffer_region region,
+                                    posix_file::ranges::range range) {
+        if(out.pread(region, range.offset(), range.size()) != range.size()) {
+            throw posix_file::io_error("issue_resumed", EIO);
+        }
+
+        m_slot_checksums[slot] =
+                posix_file::crc32c(0, region.data(), range.size());
+        return std::size_t{0};
+    });
+}
+
+block_pipeline::completed_block
+block_pipeline::wait() {
+
+    assert(!empty());
+
+    const in_flight b = m_in_flight.front();
+    m_in_flight.pop_front();
+
+    const std::size_t bytes = m_completions.pop();
+
+    return completed_block{m_regions[b.slot], b.range, bytes,
+                           m_verify ? m_slot_checksums[b.slot] : 0,
+                           b.skipped};
+}
+
+void
+block_pipeline::release(const posix_file::file& f) noexcept {
+    if(m_queue) {
+        m_queue->release(f);
+    }
+}
+
+} // namespace cargo
@@ -0,0 +1,223 @@
+/******************************************************************************
+ * Copyright 2022-2023, Barcelona Supercomputing Center (BSC), Spain
+ *
+ * This software was partially supported by the EuroHPC-funded project ADMIRE
+ *   (Project ID: 956748, https://www.admire-eurohpc.eu).
+ *
+ * This file is part of Cargo.
+ *
+ * Cargo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cargo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cargo.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *****************************************************************************/
+
+
+#ifndef CARGO_WORKER_PIPELINE_HPP
+#define CARGO_WORKER_PIPELINE_HPP
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <posix_file/types.hpp>
+#include <posix_file/ranges.hpp>
+#include <posix_file/file.hpp>
+#include <posix_file/io_queue.hpp>
+#include <posix_file/kernel_copy.hpp>
+#include <posix_file/checksum.hpp>
+#include <posix_file/container.hpp>
+#include "io_pool.hpp"
+#include "memory.hpp"
+
+namespace cargo {
+
+// Write the data in `region` into `range` of `out`, unless `out` already
+// holds the same data there, which is read into `current` for comparison.
+// Return whether the block was written
+bool
+write_if_changed(const posix_file::file& out, buffer_region region,
+                 buffer_region current, posix_file::ranges::range range);
+
+// Read `range` back from `out` into `current` to check that the data just
+// written there has checksum `crc`. Throw a `posix_file::io_error` otherwise
+void
+check_written(const posix_file::file& out, buffer_region current,
+              posix_file::ranges::range range, std::uint32_t crc);
+
+/**
+ * A bounded pipeline of asynchronous block transfers.
+ *
+ * Up to `depth` blocks can be in flight at the same time, each of them using
+ * its own block-sized slot of a buffer owned by the pipeline. The task for
+ * each block runs in an `io_pool`, so blocks are transferred concurrently,
+ * but they are reported back in the same order they were issued. This allows
+ * the caller to account for progress as a contiguous prefix of its blocks.
+ *
+ * Copies between files backed by kernel file descriptors are offloaded to the
+ * kernel (see `posix_file::kernel_copier`) so that their data does not go
+ * through the pipeline buffers. If the kernel cannot copy them by itself and
+ * the pipeline is given a `posix_file::io_queue`, their reads and writes are
+ * queued there instead of running in the pool.
+ */
+class block_pipeline {
+
+public:
+    // Transfer `range` using `region` as a staging buffer, returning the
+    // number of bytes transferred
+    using task = std::function<std::size_t(buffer_region region,
+                                           posix_file::ranges::range range)>;
+
+    struct completed_block {
+        // The region used for the block. It remains valid until the next
+        // call to `issue()`.
+        buffer_region region;
+        posix_file::ranges::range range;
+        std::size_t bytes;
+        // The CRC32C of the data in `range`, if verification is enabled
+        std::uint32_t checksum;
+        // Whether the block was accounted for by `skip()`, in which case
+        // it carries no data nor checksum
+        bool skipped;
+    };
+
+    block_pipeline(std::shared_ptr<io_pool> pool, std::size_t depth,
+                   std::size_t block_size,
+                   std::shared_ptr<posix_file::io_queue> queue = {});
+
+    block_pipeline(const block_pipeline&) = delete;
+    block_pipeline&
+    operator=(const block_pipeline&) = delete;
+
+    std::size_t
+    depth() const noexcept;
+
+    // Size of the buffer of each block
+    std::size_t
+    block_size() const noexcept;
+
+    // Number of blocks issued so far
+    std::size_t
+    issued() const noexcept;
+
+    bool
+    empty() const noexcept;
+
+    bool
+    full() const noexcept;
+
+    // Compute the CRC32C of each block right after reading it, while it is
+    // still in the cache, and read back each block written to check that the
+    // output file holds the same data. Blocks are then always copied through
+    // the pipeline buffers
+    void
+    enable_verification();
+
+    // Start transferring `range` with `t` using the next free slot
+    void
+    issue(posix_file::ranges::range range, task t);
+
+    // Start copying `range` from `in` into the same offset of `out`, using
+    // the fastest method supported by both files
+    void
+    issue_copy(const posix_file::file& in, const posix_file::file& out,
+               posix_file::ranges::range range);
+
+    // Start copying `range` from `in` into the same offset of `out`, but
+    // only write the block if it differs from the data already there. Both
+    // blocks are read into memory, so `out` must be open for reading too
+    void
+    issue_update(const posix_file::file& in, const posix_file::file& out,
+                 posix_file::ranges::range range);
+
+    // Start compressing `range` of `in` into its slot of `container` in
+    // `out`, which must hold the slots of `container`. Blocks are
+    // checksummed before compression, and the output is not read back
+    void
+    issue_compress(const posix_file::file& in, const posix_file::file& out,
+                   posix_file::block_container container,
+                   posix_file::ranges::range range, int level);
+
+    // Start extracting `range` of the original file from its slot of
+    // `container` in `in`, a file of `in_size` bytes, into the same offset
+    // of `out`
+    void
+    issue_decompress(const posix_file::file& in, std::size_t in_size,
+                     const posix_file::file& out,
+                     posix_file::block_container container,
+                     posix_file::ranges::range range);
+
+    // Number of blocks that `issue_update()` found unchanged in the output
+    // file, and thus did not write
+    std::size_t
+    unchanged() const noexcept;
+
+    // Account for `range` as a block that needs no transfer, such as a
+    // hole of a sparse file. It is reported by `wait()` in order as a
+    // skipped block, with no bytes transferred
+    void
+    skip(posix_file::ranges::range range);
+
+    // Account for `range` as a block that `out` already holds, such as one
+    // recorded in a completion journal. If verification is enabled, the
+    // block is read back from `out` to checksum it. It is reported by
+    // `wait()` in order, with no bytes transferred
+    void
+    issue_resumed(const posix_file::file& out,
+                  posix_file::ranges::range range);
+
+    // Wait for the oldest block in flight to complete. Any error raised by
+    // its task is rethrown here
+    completed_block
+    wait();
+
+    // Stop using `f` in the I/O queue before it is closed, once all its
+    // blocks have been waited for
+    void
+    release(const posix_file::file& f) noexcept;
+
+private:
+    // The slot used to read back the data of the output file for the block
+    // in `slot`
+    buffer_region
+    output_region(std::size_t slot);
+
+    struct in_flight {
+        std::size_t slot;
+        posix_file::ranges::range range;
+        bool skipped = false;
+    };
+
+    std::shared_ptr<io_pool> m_pool;
+    std::shared_ptr<posix_file::io_queue> m_queue;
+    memory_buffer m_buffer;
+    std::vector<buffer_region> m_regions;
+    posix_file::kernel_copier m_copier;
+    std::size_t m_issued = 0;
+    std::deque<in_flight> m_in_flight;
+    // slots for the blocks read back from the output file, or for the
+    // compressed blocks, allocated on first use
+    memory_buffer m_output_buffer;
+    std::vector<buffer_region> m_output_regions;
+    std::atomic<std::size_t> m_unchanged = 0;
+    bool m_verify = false;
+    // the checksum of the block in each slot
+    std::vector<std::uint32_t> m_slot_checksums;
+    // declared after the buffer so that outstanding tasks are waited for
+    // before their memory is released
+    completion_queue m_completions;
+};
+
+} // namespace cargo
+
+#endif // CARGO_WORKER_PIPELINE_HPP
@@ -25,69 +25,19 @@
 #ifndef CARGO_WORKER_SEQ_MIXED_HPP
 #define CARGO_WORKER_SEQ_MIXED_HPP
 
-#include "ops.hpp"
-#include <posix_file/file.hpp>
-#include <posix_file/views.hpp>
-#include "ops.hpp"
-#include "memory.hpp"
-
-namespace mpi = boost::mpi;
+#include "sequential.hpp"
 
 namespace cargo {
 
-class seq_mixed_operation : public operation {
+// A sequential transfer between file systems of different types. Each file
+// is accessed through the plugin of its own file system, so the transfer
+// proceeds exactly as a sequential one
+class seq_mixed_operation : public seq_operation {
 
 public:
-    seq_mixed_operation(mpi::communicator workers,
-                        std::filesystem::path input_path,
-                        std::filesystem::path output_path,
-                        std::uint64_t block_size, FSPlugin::type fs_i_type,
-                        FSPlugin::type fs_o_type)
-        : m_workers(std::move(workers)), m_input_path(std::move(input_path)),
-          m_output_path(std::move(output_path)),
-          m_kb_size(std::move(block_size)), m_fs_i_type(fs_i_type),
-          m_fs_o_type(fs_o_type) {}
-
-    cargo::error_code
-    operator()() final;
-    cargo::error_code
-    progress() const;
-
-    int
-    progress(int ongoing_index) final;
-
-    std::string
-    output_path() const {
-        return m_output_path;
-    }
-
-    std::string
-    input_path() const {
-        return m_input_path;
-    }
-
-private:
-    mpi::communicator m_workers;
-    std::filesystem::path m_input_path{};
-    std::filesystem::path m_output_path{};
-    std::unique_ptr<posix_file::file> m_input_file;
-    std::unique_ptr<posix_file::file> m_output_file;
-    int m_workers_size;
-    int m_workers_rank;
-    std::size_t m_block_size;
-    std::size_t m_file_size;
-    int m_total_blocks;
-
-    memory_buffer m_buffer;
-    std::vector<buffer_region> m_buffer_regions;
-    std::size_t m_bytes_per_rank;
-    std::uint64_t m_kb_size;
-    FSPlugin::type m_fs_i_type;
-    FSPlugin::type m_fs_o_type;
-    cargo::error_code m_status;
-    bool write{};
+    using seq_operation::seq_operation;
 };
 
 } // namespace cargo
 
-#endif // CARGO_WORKER_SEQUENTIAL_HPP
+#endif // CARGO_WORKER_SEQ_MIXED_HPP
@@ -43,34 +43,126 @@ seq_operation::operator()() {
                 posix_file::open(m_input_path, O_RDONLY, 0, m_fs_i_type));
         std::size_t file_size = m_input_file->size();
 
+        // blocks of a compressed container are stored in slots of
+        // `block_size` bytes, each of them holding `plan_block_size` bytes
+        // of the original file
+        if(compression()) {
+            m_container = posix_file::block_container::probe(*m_input_file);
+
+            if(m_container) {
+                m_decompress = true;
+                m_container_size = file_size;
+                file_size = m_container->file_size();
+                block_size = m_container->block_size();
+            } else if(m_fs_o_type == FSPlugin::type::posix &&
+                      m_fs_i_type != FSPlugin::type::posix &&
+                      m_fs_i_type != FSPlugin::type::parallel) {
+                block_size = posix_file::block_container::default_block_size;
+                m_container = posix_file::block_container{file_size,
+                                                          block_size};
+            }
+        }
+
+        const std::size_t plan_block_size =
+                m_container ? m_container->payload_size() : block_size;
+
 
         // compute the number of blocks in the file
-        int total_blocks = static_cast<int>(file_size / block_size);
+        int total_blocks = static_cast<int>(file_size / plan_block_size);
 
-        if(file_size % block_size != 0) {
+        if(file_size % plan_block_size != 0) {
             ++total_blocks;
         }
 
-        // find how many blocks this rank is responsible for
-        std::size_t blocks_per_rank = total_blocks / workers_size;
+        // find which blocks this rank is responsible for, unless the master
+        // hands them out while the transfer progresses. The master does not
+        // know the layout of containers, so their blocks are always split
+        // evenly
+        const bool dynamic = chunk_blocks() != 0 && !m_container;
+
+        if(dynamic) {
+            m_plan = posix_file::block_plan{
+                    static_cast<std::size_t>(file_size), plan_block_size};
+        } else {
+            m_plan = posix_file::block_plan{
+                    static_cast<std::size_t>(file_size), plan_block_size,
+                    static_cast<std::size_t>(workers_size),
+                    static_cast<std::size_t>(workers_rank)};
+        }
 
-        if(int64_t n = total_blocks % workers_size;
-           n != 0 && workers_rank < n) {
-            ++blocks_per_rank;
+        const std::size_t blocks_per_rank =
+                dynamic ? (m_plan.size() + workers_size - 1) / workers_size
+                        : m_plan.size();
+
+        // step 1. acquire the buffers of the block pipeline: at most
+        // `pipeline_depth()` blocks (but at least one per I/O thread) are
+        // held in memory at once
+        const std::size_t depth = std::max<std::size_t>(
+                std::min({std::max(pipeline_depth(), pool()->size()),
+                          blocks_per_round(block_size), blocks_per_rank}),
+                1);
+
+        // each block copy takes two requests (a read and a linked write)
+        m_pipeline = std::make_unique<block_pipeline>(
+                pool(), depth, block_size, make_io_queue(2 * depth));
+
+        // each rank starts with its own chunk of blocks and claims the next
+        // one while the blocks left can still keep the pipeline full
+        if(dynamic) {
+            m_blocks = block_queue{m_plan, workers_rank * chunk_blocks(),
+                                   chunk_blocks(), depth};
+        } else {
+            m_blocks = block_queue{m_plan};
         }
 
-        // step 1. acquire buffers
+        m_output_file = std::make_unique<posix_file::file>(posix_file::create(
+                m_output_path, incremental() || verify() ? O_RDWR : O_WRONLY,
+                S_IRUSR | S_IWUSR, m_fs_o_type));
+
+        // holes in the input file are not transferred: they are recreated
+        // in the output file instead, if its file system supports them
+        if(!m_container) {
+            m_extents = m_input_file->extents();
+            m_sparse = m_extents.data_size() < file_size &&
+                       m_output_file->truncate(file_size);
+        }
+
+        if(m_container && !m_decompress) {
+            // the unused tail of each slot is left as a hole
+            m_output_file->truncate(m_container->capacity());
+        } else if(!m_sparse) {
+            m_extents = posix_file::extent_map{};
 
-        m_buffer.resize(blocks_per_rank * block_size);
-        m_buffer_regions.reserve(blocks_per_rank);
+            // in incremental mode, the blocks already in the output file are
+            // read back, so it must not keep any data beyond the input size
+            if(incremental()) {
+                m_output_file->truncate(file_size);
+            }
 
-        for(std::size_t i = 0; i < blocks_per_rank; ++i) {
-            m_buffer_regions.emplace_back(m_buffer.data() + i * block_size,
-                                          block_size);
+            m_output_file->fallocate(0, 0, file_size);
         }
 
-        m_input_file = std::make_unique<posix_file::file>(
-                posix_file::open(m_input_path, O_RDONLY, 0, m_fs_i_type));
+        // blocks recorded by an interrupted transfer of the same file are not
+        // transferred again. The checksum of a block that was already
+        // compressed cannot be read back from its slot, though, so verified
+        // compressed transfers always start from scratch
+        if(!journal_dir().empty() &&
+           !(verify() && m_container && !m_decompress)) {
+            m_journal.emplace(journal_dir(), m_output_path, *m_input_file,
+                              file_size, plan_block_size, workers_rank);
+
+            if(m_journal->resumed() != 0) {
+                LOGGER_INFO("Resuming {}: {} of {} blocks already transferred",
+                            m_output_path.string(), m_journal->resumed(),
+                            total_blocks);
+            }
+        }
+
+        // each block is checksummed as it is read and checked once written
+        if(verify()) {
+            m_pipeline->enable_verification();
+            m_digest = posix_file::file_digest{file_size};
+        }
 
         m_workers_size = workers_size;
         m_workers_rank = workers_rank;
@@ -92,140 +184,187 @@ seq_operation::operator()() {
         return error_code::other;
     }
 
+    m_status = error_code::transfer_in_progress;
     return error_code::transfer_in_progress;
 }
 
+void
+seq_operation::grant_blocks(std::uint64_t first, std::uint64_t count) {
+    m_blocks.grant(first, count);
+}
+
+std::optional<std::uint32_t>
+seq_operation::checksum() const {
+    return verify() ? std::optional{m_digest.value()} : std::nullopt;
+}
+
+void
+seq_operation::add_holes(posix_file::ranges::range range,
+                         std::optional<posix_file::ranges::range> data) {
+
+    if(!data) {
+        m_digest.add_zeros(range);
+        return;
+    }
+
+    const auto begin = range.offset();
+    const auto end = begin + static_cast<posix_file::offset>(range.size());
+    const auto data_begin = data->offset();
+    const auto data_end =
+            data_begin + static_cast<posix_file::offset>(data->size());
+
+    if(data_begin > begin) {
+        m_digest.add_zeros(
+                {begin, static_cast<std::size_t>(data_begin - begin)});
+    }
+
+    if(end > data_end) {
+        m_digest.add_zeros(
+                {data_end, static_cast<std::size_t>(end - data_end)});
+    }
+}
+
 cargo::error_code
 seq_operation::progress() const {
     return m_status;
 }
 
-int
-seq_operation::progress(int ongoing_index) {
-    using posix_file::views::all_of;
-    using posix_file::views::as_blocks;
-    using posix_file::views::strided;
+void
+seq_operation::issue(posix_file::ranges::range range) {
+
+    if(m_container) {
+        if(m_decompress) {
+            m_pipeline->issue_decompress(*m_input_file, m_container_size,
+                                         *m_output_file, *m_container, range);
+        } else {
+            m_pipeline->issue_compress(
+                    *m_input_file, *m_output_file, *m_container, range,
+                    posix_file::block_container::default_level);
+        }
+        return;
+    }
 
-    // compute the number of blocks in the file
+    if(incremental()) {
+        m_pipeline->issue_update(*m_input_file, *m_output_file, range);
+        return;
+    }
 
-    int index = 0;
-    if(write == false) {
-        if(ongoing_index == 0) {
-            m_bytes_per_rank = 0;
-        }
-        try {
-            for(const auto& file_range :
-                all_of(*m_input_file) | as_blocks(m_block_size) |
-                        strided(m_workers_size, m_workers_rank)) {
+    m_pipeline->issue_copy(*m_input_file, *m_output_file, range);
+}
 
-                if(index < ongoing_index) {
-                    ++index;
-                    continue;
-                } else {
-                    if(index > ongoing_index) {
-                        return index;
-                    }
-                }
-                m_status = error_code::transfer_in_progress;
-                assert(m_buffer_regions[index].size() >= file_range.size());
-                auto start = std::chrono::steady_clock::now();
-                const std::size_t n = m_input_file->pread(
-                        m_buffer_regions[index], file_range.offset(),
-                        file_range.size());
-
-                LOGGER_DEBUG("Buffer contents: [\"{}\" ... \"{}\"]",
-                             fmt::join(buffer_regions[index].begin(),
-                                       buffer_regions[index].begin() + 10, ""),
-                             fmt::join(buffer_regions[index].end() - 10,
-                                       buffer_regions[index].end(), ""));
-
-
-                m_bytes_per_rank += n;
-                // Do sleep
-                std::this_thread::sleep_for(sleep_value());
-                auto end = std::chrono::steady_clock::now();
-                // Send transfer bw
-                double elapsed_seconds =
-                        std::chrono::duration_cast<
-                                std::chrono::duration<double>>(end - start)
-                                .count();
-                if((elapsed_seconds) > 0) {
-                    bw((m_block_size / (1024.0 * 1024.0)) / (elapsed_seconds));
-                    LOGGER_DEBUG(
-                            "BW (read) Update: {} / {} = {} mb/s [ Sleep {} ]",
-                            m_block_size / 1024.0, elapsed_seconds, bw(),
-                            sleep_value());
-                }
+void
+seq_operation::finish() {
 
-                ++index;
-            }
-        } catch(const posix_file::io_error& e) {
-            LOGGER_ERROR("{}() failed: {}", e.where(), e.what());
-            m_status = make_system_error(e.error_code());
-            return -1;
-        } catch(const std::system_error& e) {
-            LOGGER_ERROR("Unexpected system error: {}", e.what());
-            m_status = make_system_error(e.code().value());
-            return -1;
-        } catch(const std::exception& e) {
-            LOGGER_ERROR("Unexpected exception: {}", e.what());
-            m_status = error_code::other;
-            return -1;
-        }
-         write = true;
-        ongoing_index = 0;
+    if(incremental()) {
+        LOGGER_INFO("{} of {} blocks of {} were unchanged",
+                    m_pipeline->unchanged(), m_pipeline->issued(),
+                    m_output_path.string());
     }
-   
-    // We finished reading
-    // step3. POSIX write data
-    // We need to create the directory if it does not exists (using
-    // FSPlugin)
 
-    if(write and ongoing_index == 0) {
-        m_output_file = std::make_unique<posix_file::file>(posix_file::create(
-                m_output_path, O_WRONLY, S_IRUSR | S_IWUSR, m_fs_o_type));
-
-        m_output_file->fallocate(0, 0, m_file_size);
+    if(m_journal) {
+        m_journal->flush(*m_output_file);
     }
 
+    m_status = error_code::success;
+}
+
+int
+seq_operation::progress(int ongoing_index) {
+
+    if(ongoing_index == 0) {
+        m_bytes_per_rank = 0;
+    }
     try {
-        int index = 0;
         m_status = error_code::transfer_in_progress;
-        for(const auto& file_range :
-            all_of(posix_file::file{m_input_path, m_fs_i_type}) | as_blocks(m_block_size) |
-                    strided(m_workers_size, m_workers_rank)) {
-            if(index < ongoing_index) {
-                ++index;
+
+        // step 2. keep the pipeline full so that several blocks are read
+        // and written concurrently, as long as the rate limit allows it
+        while(!m_pipeline->full() && !throttled()) {
+            const auto next = m_blocks.next();
+
+            if(!next) {
+                break;
+            }
+
+            const auto range = *next;
+
+            if(m_journal && m_journal->completed(range)) {
+                m_pipeline->issue_resumed(*m_output_file, range);
                 continue;
-            } else {
-                if(index > ongoing_index) {
-                    return index;
+            }
+
+            if(m_sparse) {
+                const auto data = m_extents.data_in(range);
+
+                // clear any stale data left in the holes of the block if the
+                // output file already existed
+                if(data != range) {
+                    m_output_file->punch_hole(range.offset(), range.size());
+                }
+
+                if(verify()) {
+                    add_holes(range, data);
                 }
+
+                if(!data) {
+                    m_pipeline->skip(range);
+                    continue;
+                }
+
+                consume(data->size());
+                issue(*data);
+                continue;
             }
 
-            assert(m_buffer_regions[index].size() >= file_range.size());
-            auto start = std::chrono::steady_clock::now();
-            m_output_file->pwrite(m_buffer_regions[index], file_range.offset(),
-                                  file_range.size());
-            // Do sleep
-            std::this_thread::sleep_for(sleep_value());
-            auto end = std::chrono::steady_clock::now();
-            // Send transfer bw
-            double elapsed_seconds =
-                    std::chrono::duration_cast<std::chrono::duration<double>>(
-                            end - start)
-                            .count();
-            if((elapsed_seconds) > 0) {
-                bw((m_block_size / (1024.0 * 1024.0)) / (elapsed_seconds));
-                LOGGER_DEBUG(
-                        "BW (write) Update: {} / {} = {} mb/s [ Sleep {} ]",
-                        m_block_size / 1024.0, elapsed_seconds, bw(),
-                        sleep_value());
+            consume(range.size());
+            issue(range);
+        }
+
+        if(m_blocks.needs_claim()) {
+            request_blocks();
+            m_blocks.claim_sent();
+        }
+
+        if(m_pipeline->empty()) {
+            if(!m_blocks.done()) {
+                // throttled or waiting for more blocks: let other operations
+                // progress in the meantime
+                return ongoing_index;
             }
+            finish();
+            return -1;
+        }
 
-            ++index;
+        // step 3. account for the oldest block once it has been written, so
+        // that progress is always reported for a contiguous prefix of blocks
+        const auto block = m_pipeline->wait();
+
+        LOGGER_DEBUG("Buffer contents: [\"{}\" ... \"{}\"]",
+                     fmt::join(block.region.begin(),
+                               block.region.begin() + 10, ""),
+                     fmt::join(block.region.end() - 10,
+                               block.region.end(), ""));
+
+        m_bytes_per_rank += block.bytes;
+        account(block.bytes);
+
+        // the holes of skipped blocks were already added by `add_holes()`
+        if(verify() && !block.skipped) {
+            m_digest.add(block.range, block.checksum);
+        }
+
+        if(m_journal) {
+            m_journal->complete(block.range);
+
+            if(m_journal->flush_due()) {
+                m_journal->flush(*m_output_file);
+            }
         }
 
+        if(m_blocks.done() && m_pipeline->empty()) {
+            finish();
+            return -1;
+        }
     } catch(const posix_file::io_error& e) {
         LOGGER_ERROR("{}() failed: {}", e.where(), e.what());
         m_status = make_system_error(e.error_code());
@@ -240,8 +379,7 @@ seq_operation::progress(int ongoing_index) {
         return -1;
     }
 
-    m_status = error_code::success;
-    return -1;
+    return ongoing_index + 1;
 }
 
 } // namespace cargo
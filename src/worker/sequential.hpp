@@ -28,8 +28,12 @@
 #include "ops.hpp"
 #include <posix_file/file.hpp>
 #include <posix_file/views.hpp>
+#include <posix_file/block_plan.hpp>
+#include <posix_file/journal.hpp>
 #include "ops.hpp"
 #include "memory.hpp"
+#include "pipeline.hpp"
+#include "block_queue.hpp"
 
 namespace mpi = boost::mpi;
 
@@ -54,6 +58,12 @@ public:
     int
     progress(int ongoing_index) final;
 
+    void
+    grant_blocks(std::uint64_t first, std::uint64_t count) final;
+
+    std::optional<std::uint32_t>
+    checksum() const final;
+
     std::string
     output_path() const {
         return m_output_path;
@@ -65,6 +75,21 @@ public:
     }
 
 private:
+    // Start transferring `range`, writing only the blocks that changed in
+    // incremental mode, or going through `m_container` if it is set
+    void
+    issue(posix_file::ranges::range range);
+
+    // Add the parts of `range` outside of `data` to the digest, since they
+    // are holes of the input file that are not transferred
+    void
+    add_holes(posix_file::ranges::range range,
+              std::optional<posix_file::ranges::range> data);
+
+    // Report the transfer as successful
+    void
+    finish();
+
     mpi::communicator m_workers;
     std::unique_ptr<posix_file::file> m_input_file;
     std::unique_ptr<posix_file::file> m_output_file;
@@ -75,15 +100,33 @@ private:
     std::size_t m_block_size;
     std::size_t m_file_size;
     int m_total_blocks;
+    // Blocks this rank is responsible for, or all the blocks of the file if
+    // the master hands them out
+    posix_file::block_plan m_plan;
+    // Blocks left to transfer
+    block_queue m_blocks;
+    // Data extents of the input file, if its holes are recreated in the
+    // output file
+    posix_file::extent_map m_extents;
+    bool m_sparse = false;
+    // Layout of the output file if it is compressed, or of the input file if
+    // it is decompressed
+    std::optional<posix_file::block_container> m_container;
+    bool m_decompress = false;
+    // Size of the container read from the input file, if it is decompressed
+    std::size_t m_container_size = 0;
+    // Digest of the blocks transferred by this rank, if they are verified
+    posix_file::file_digest m_digest;
+    // Blocks of the output file already completed, if they are journaled
+    std::optional<posix_file::completion_journal> m_journal;
 
-    memory_buffer m_buffer;
-    std::vector<buffer_region> m_buffer_regions;
+    // must be destroyed before the files, since in-flight blocks use them
+    std::unique_ptr<block_pipeline> m_pipeline;
     std::size_t m_bytes_per_rank;
     std::uint64_t m_kb_size;
     FSPlugin::type m_fs_i_type;
     FSPlugin::type m_fs_o_type;
     cargo::error_code m_status;
-    bool write{};
 };
 
 } // namespace cargo
@@ -0,0 +1,164 @@
+/******************************************************************************
+ * Copyright 2022-2023, Barcelona Supercomputing Center (BSC), Spain
+ *
+ * This software was partially supported by the EuroHPC-funded project ADMIRE
+ *   (Project ID: 956748, https://www.admire-eurohpc.eu).
+ *
+ * This file is part of Cargo.
+ *
+ * Cargo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cargo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cargo.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *****************************************************************************/
+
+
+#include <algorithm>
+#include <boost/mpi.hpp>
+#include <logger/logger.hpp>
+#include "status_reporter.hpp"
+
+namespace mpi = boost::mpi;
+
+namespace cargo {
+
+status_reporter::status_reporter(std::chrono::milliseconds interval,
+                                 std::size_t max_updates)
+    : m_interval(interval),
+      m_max_updates(std::max<std::size_t>(max_updates, 1)) {}
+
+void
+status_reporter::reduce_through(status_tree tree) {
+    m_tree = std::move(tree);
+}
+
+bool
+status_reporter::reduces() const noexcept {
+    return m_tree.has_value();
+}
+
+void
+status_reporter::report(int dest, status_message m) {
+
+    if(m_tree) {
+        enqueue(m_tree->parent(), m_tree->reduce(m_tree->rank(), m));
+        return;
+    }
+
+    enqueue(dest, std::move(m));
+}
+
+void
+status_reporter::merge(int source, const status_report_message& r) {
+
+    if(!m_tree) {
+        LOGGER_WARN("Unexpected status report from {}", source);
+        return;
+    }
+
+    for(const auto& m : r.updates()) {
+        enqueue(m_tree->parent(), m_tree->reduce(source, m));
+    }
+}
+
+void
+status_reporter::enqueue(int dest, status_message m) {
+
+    auto& q = m_queues[dest];
+
+    if(q.report.size() == 0) {
+        q.since = clock::now();
+    }
+
+    const auto final = m.state() == transfer_state::completed ||
+                       m.state() == transfer_state::failed;
+
+    const auto [it, inserted] = q.index.emplace(
+            std::make_tuple(m.tid(), m.seqno()), q.report.size());
+
+    if(inserted) {
+        q.report.add(std::move(m));
+    } else {
+        q.report.updates()[it->second] = std::move(m);
+    }
+
+    if(final || q.report.size() >= m_max_updates) {
+        flush(dest, q);
+    }
+}
+
+void
+status_reporter::flush_due() {
+
+    const auto now = clock::now();
+
+    for(auto& [dest, q] : m_queues) {
+        if(q.report.size() != 0 && now - q.since >= m_interval) {
+            flush(dest, q);
+        }
+    }
+}
+
+void
+status_reporter::flush() {
+    for(auto& [dest, q] : m_queues) {
+        flush(dest, q);
+    }
+}
+
+void
+status_reporter::retire() {
+    std::erase_if(m_sends,
+                  [](send& s) { return s.request.test().has_value(); });
+}
+
+void
+status_reporter::wait() {
+
+    for(auto& s : m_sends) {
+        s.request.wait();
+    }
+
+    m_sends.clear();
+}
+
+std::size_t
+status_reporter::pending() const noexcept {
+    std::size_t n = 0;
+    for(const auto& [dest, q] : m_queues) {
+        n += q.report.size();
+    }
+    return n;
+}
+
+void
+status_reporter::flush(int dest, queue& q) {
+
+    if(q.report.size() == 0) {
+        return;
+    }
+
+    mpi::communicator world;
+    LOGGER_DEBUG("msg <= to: {} body: {{payload: {}}}", dest, q.report);
+
+    auto& s = m_sends.emplace_back(
+            send{std::make_unique<mpi::packed_oarchive>(world), {}});
+    *s.archive << q.report;
+    s.request = world.isend(dest, static_cast<int>(tag::status_report),
+                            *s.archive);
+
+    q.report = status_report_message{};
+    q.index.clear();
+}
+
+} // namespace cargo
@@ -0,0 +1,147 @@
+/******************************************************************************
+ * Copyright 2022-2023, Barcelona Supercomputing Center (BSC), Spain
+ *
+ * This software was partially supported by the EuroHPC-funded project ADMIRE
+ *   (Project ID: 956748, https://www.admire-eurohpc.eu).
+ *
+ * This file is part of Cargo.
+ *
+ * Cargo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cargo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cargo.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *****************************************************************************/
+
+
+#ifndef CARGO_WORKER_STATUS_REPORTER_HPP
+#define CARGO_WORKER_STATUS_REPORTER_HPP
+
+#include <boost/mpi/packed_oarchive.hpp>
+#include <boost/mpi/request.hpp>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <tuple>
+#include <optional>
+#include <vector>
+#include "proto/mpi/message.hpp"
+#include "status_tree.hpp"
+
+namespace cargo {
+
+/**
+ * Coalesces the status updates that the operations of a worker send to the
+ * master.
+ *
+ * Updates are queued per destination and only the latest one of each file
+ * is kept, so the bandwidth reported after each block replaces the previous
+ * one instead of adding another message. The queue of a destination is sent
+ * as a single `status_report_message` once its oldest update has waited for
+ * `interval`, once it holds `max_updates` files, or as soon as a file
+ * completes or fails, so that the master learns about them without delay.
+ *
+ * If the workers report through a `status_tree`, the updates of a worker and
+ * those forwarded by its children are reduced to a summary of each file,
+ * which is sent to its parent instead.
+ *
+ * Reports are sent without blocking, since a parent worker may be busy in a
+ * collective call with the sender. The reporter keeps each report until its
+ * send completes, which `retire()` checks.
+ *
+ * The reporter is not thread-safe: it is used by the thread that progresses
+ * the operations of a worker.
+ */
+class status_reporter {
+
+public:
+    using clock = std::chrono::steady_clock;
+
+    static constexpr std::chrono::milliseconds default_interval{100};
+    static constexpr std::size_t default_max_updates = 256;
+
+    explicit status_reporter(
+            std::chrono::milliseconds interval = default_interval,
+            std::size_t max_updates = default_max_updates);
+
+    // Report through `tree` from now on
+    void
+    reduce_through(status_tree tree);
+
+    // Whether the updates are reported through a tree
+    bool
+    reduces() const noexcept;
+
+    // Queue update `m` for rank `dest`, replacing any update of the same
+    // file that has not been sent yet. In a tree, the summary of the file
+    // is queued for the parent instead
+    void
+    report(int dest, status_message m);
+
+    // Reduce the updates in report `r`, forwarded by child `source` in the
+    // tree, and queue their summaries for the parent
+    void
+    merge(int source, const status_report_message& r);
+
+    // Send the updates of the destinations whose oldest update has waited
+    // for `interval`
+    void
+    flush_due();
+
+    // Send all the queued updates
+    void
+    flush();
+
+    // Release the reports whose sends have completed
+    void
+    retire();
+
+    // Wait for the sends of all the reports to complete
+    void
+    wait();
+
+    // Number of updates queued for all destinations
+    std::size_t
+    pending() const noexcept;
+
+private:
+    struct queue {
+        status_report_message report;
+        // position of each file (tid, seqno) in `report`
+        std::map<std::tuple<std::uint64_t, std::uint32_t>, std::size_t> index;
+        clock::time_point since;
+    };
+
+    // a report being sent, which must outlive its request
+    struct send {
+        std::unique_ptr<boost::mpi::packed_oarchive> archive;
+        boost::mpi::request request;
+    };
+
+    void
+    enqueue(int dest, status_message m);
+
+    void
+    flush(int dest, queue& q);
+
+    std::chrono::milliseconds m_interval;
+    std::size_t m_max_updates;
+    std::map<int, queue> m_queues;
+    std::vector<send> m_sends;
+    std::optional<status_tree> m_tree;
+};
+
+} // namespace cargo
+
+#endif // CARGO_WORKER_STATUS_REPORTER_HPP
@@ -0,0 +1,150 @@
+/******************************************************************************
+ * Copyright 2022-2023, Barcelona Supercomputing Center (BSC), Spain
+ *
+ * This software was partially supported by the EuroHPC-funded project ADMIRE
+ *   (Project ID: 956748, https://www.admire-eurohpc.eu).
+ *
+ * This file is part of Cargo.
+ *
+ * Cargo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cargo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cargo.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *****************************************************************************/
+
+
+#include <algorithm>
+#include "status_tree.hpp"
+
+namespace {
+
+// Number of workers in the subtree rooted at worker `wid`
+std::size_t
+subtree_size(std::size_t workers, std::size_t wid, std::size_t arity) {
+
+    std::size_t n = 0;
+
+    // the descendants of `wid` at each level are consecutive
+    for(std::size_t first = wid, last = wid; first < workers;
+        first = first * arity + 1, last = last * arity + arity) {
+        n += std::min(last, workers - 1) - first + 1;
+    }
+
+    return n;
+}
+
+} // namespace
+
+namespace cargo {
+
+status_tree::status_tree(std::size_t workers, std::size_t wid,
+                         std::size_t arity)
+    : m_rank(static_cast<int>(wid + 1)),
+      m_parent(wid == 0 ? 0 : static_cast<int>((wid - 1) / arity + 1)),
+      m_parts(subtree_size(workers, wid, arity)) {
+
+    for(std::size_t c = wid * arity + 1;
+        c < std::min(wid * arity + arity + 1, workers); ++c) {
+        m_children.push_back(static_cast<int>(c + 1));
+    }
+}
+
+int
+status_tree::rank() const noexcept {
+    return m_rank;
+}
+
+int
+status_tree::parent() const noexcept {
+    return m_parent;
+}
+
+const std::vector<int>&
+status_tree::children() const noexcept {
+    return m_children;
+}
+
+std::size_t
+status_tree::parts() const noexcept {
+    return m_parts;
+}
+
+status_message
+status_tree::reduce(int source, const status_message& m) {
+
+    const file_key key{m.tid(), m.seqno()};
+    auto& sources = m_files[key];
+
+    sources[source] = part_state{m.state(), m.bw(), m.error_code(),
+                                 m.checksum(), m.parts()};
+
+    // parts that have completed or failed
+    std::size_t finished = 0;
+    bool started = false;
+    bool failed = false;
+    float bw = 0.0f;
+    std::optional<error_code> ec;
+    std::optional<std::uint32_t> checksum;
+
+    for(const auto& [rank, ps] : sources) {
+
+        bw += ps.bw;
+
+        if(!ec && ps.ec) {
+            ec = ps.ec;
+        }
+
+        switch(ps.state) {
+            case transfer_state::completed:
+                finished += ps.parts;
+                if(ps.checksum) {
+                    checksum = checksum.value_or(0) ^ *ps.checksum;
+                }
+                started = true;
+                break;
+            case transfer_state::failed:
+                failed = true;
+                finished += ps.parts;
+                break;
+            case transfer_state::running:
+                started = true;
+                break;
+            default:
+                break;
+        }
+    }
+
+    transfer_state state = transfer_state::pending;
+
+    if(finished == m_parts) {
+        state = failed ? transfer_state::failed : transfer_state::completed;
+        // the parts of the file will not change any more
+        m_files.erase(key);
+    } else if(started || failed) {
+        // a failure is only final once the other parts are, so that the
+        // parent receives a single final summary of the subtree
+        state = transfer_state::running;
+    }
+
+    return status_message{m.tid(),
+                          m.seqno(),
+                          m.name(),
+                          state,
+                          bw,
+                          state == transfer_state::failed ? ec : std::nullopt,
+                          state == transfer_state::completed ? checksum
+                                                             : std::nullopt,
+                          static_cast<std::uint32_t>(m_parts)};
+}
+
+} // namespace cargo
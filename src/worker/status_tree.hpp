@@ -0,0 +1,106 @@
+/******************************************************************************
+ * Copyright 2022-2023, Barcelona Supercomputing Center (BSC), Spain
+ *
+ * This software was partially supported by the EuroHPC-funded project ADMIRE
+ *   (Project ID: 956748, https://www.admire-eurohpc.eu).
+ *
+ * This file is part of Cargo.
+ *
+ * Cargo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cargo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cargo.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *****************************************************************************/
+
+
+#ifndef CARGO_WORKER_STATUS_TREE_HPP
+#define CARGO_WORKER_STATUS_TREE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <tuple>
+#include <vector>
+#include "proto/mpi/message.hpp"
+
+namespace cargo {
+
+/**
+ * A node of the k-ary tree over the workers through which their status
+ * updates are reduced on their way to the master.
+ *
+ * Worker `w` (its rank minus one) reports to worker `(w - 1) / arity`, and
+ * worker 0 reports to the master. Each node keeps the latest update of every
+ * file from itself and from each of its children, and combines them into a
+ * single update that summarizes the parts of the file of its whole subtree:
+ *
+ *  - once all parts have completed or failed, the file has failed if any
+ *    part has failed, and has completed otherwise. Until then, it is running
+ *    if any part has started or failed;
+ *  - the bandwidth is the sum of those of the parts;
+ *  - the error code of a failed file is the first one reported;
+ *  - once all parts have completed, the digest is the XOR of theirs.
+ *
+ * Children that have not reported a file yet count as pending.
+ */
+class status_tree {
+
+public:
+    status_tree(std::size_t workers, std::size_t wid, std::size_t arity);
+
+    // The rank of this worker
+    int
+    rank() const noexcept;
+
+    // The rank that this worker reports to
+    int
+    parent() const noexcept;
+
+    // The ranks of the workers that report to this one
+    const std::vector<int>&
+    children() const noexcept;
+
+    // Number of workers in the subtree rooted at this one
+    std::size_t
+    parts() const noexcept;
+
+    // Record update `m` from rank `source`, either this worker or one of its
+    // children, and return the summary of its file
+    status_message
+    reduce(int source, const status_message& m);
+
+private:
+    struct part_state {
+        transfer_state state{transfer_state::pending};
+        float bw{};
+        std::optional<error_code> ec;
+        std::optional<std::uint32_t> checksum;
+        // this worker accounts for its own part, each child for its subtree
+        std::uint32_t parts{1};
+    };
+
+    using file_key = std::tuple<std::uint64_t, std::uint32_t>;
+
+    int m_rank;
+    int m_parent;
+    std::vector<int> m_children;
+    std::size_t m_parts;
+    // the latest state reported by each rank for the files in progress,
+    // which are forgotten once their final summary has been returned
+    std::map<file_key, std::map<int, part_state>> m_files;
+};
+
+} // namespace cargo
+
+#endif // CARGO_WORKER_STATUS_TREE_HPP
@@ -0,0 +1,106 @@
+/******************************************************************************
+ * Copyright 2022-2023, Barcelona Supercomputing Center (BSC), Spain
+ *
+ * This software was partially supported by the EuroHPC-funded project ADMIRE
+ *   (Project ID: 956748, https://www.admire-eurohpc.eu).
+ *
+ * This file is part of Cargo.
+ *
+ * Cargo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cargo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cargo.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *****************************************************************************/
+
+
+#include "token_bucket.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace cargo {
+
+namespace {
+
+double
+capacity_for(std::uint64_t rate) {
+    return std::max(static_cast<double>(rate) *
+                            std::chrono::duration<double>(
+                                    token_bucket::burst_window)
+                                    .count(),
+                    1.0);
+}
+
+} // namespace
+
+token_bucket::token_bucket(std::uint64_t rate)
+    : m_rate(rate), m_capacity(capacity_for(rate)), m_tokens(m_capacity),
+      m_last(clock::now()) {}
+
+std::uint64_t
+token_bucket::rate() const noexcept {
+    return m_rate;
+}
+
+void
+token_bucket::set_rate(std::uint64_t rate) {
+    refill(clock::now());
+    m_rate = rate;
+    m_capacity = capacity_for(rate);
+    m_tokens = std::min(m_tokens, m_capacity);
+
+    if(m_rate == 0) {
+        m_tokens = m_capacity;
+    }
+}
+
+bool
+token_bucket::ready() {
+    if(m_rate == 0) {
+        return true;
+    }
+
+    refill(clock::now());
+    return m_tokens > 0.0;
+}
+
+std::chrono::nanoseconds
+token_bucket::delay() {
+    if(ready()) {
+        return std::chrono::nanoseconds{0};
+    }
+
+    // time until the bucket holds at least one token
+    const double seconds = (1.0 - m_tokens) / static_cast<double>(m_rate);
+    return std::chrono::nanoseconds{
+            static_cast<std::int64_t>(std::ceil(seconds * 1e9))};
+}
+
+void
+token_bucket::consume(std::size_t bytes) {
+    if(m_rate == 0) {
+        return;
+    }
+
+    refill(clock::now());
+    m_tokens -= static_cast<double>(bytes);
+}
+
+void
+token_bucket::refill(clock::time_point now) {
+    const std::chrono::duration<double> elapsed = now - m_last;
+    m_last = now;
+    m_tokens = std::min(m_capacity,
+                        m_tokens + elapsed.count() * static_cast<double>(m_rate));
+}
+
+} // namespace cargo
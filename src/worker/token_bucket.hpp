@@ -0,0 +1,86 @@
+/******************************************************************************
+ * Copyright 2022-2023, Barcelona Supercomputing Center (BSC), Spain
+ *
+ * This software was partially supported by the EuroHPC-funded project ADMIRE
+ *   (Project ID: 956748, https://www.admire-eurohpc.eu).
+ *
+ * This file is part of Cargo.
+ *
+ * Cargo is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Cargo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Cargo.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *****************************************************************************/
+
+
+#ifndef CARGO_WORKER_TOKEN_BUCKET_HPP
+#define CARGO_WORKER_TOKEN_BUCKET_HPP
+
+#include <chrono>
+#include <cstdint>
+
+namespace cargo {
+
+/**
+ * A token bucket that limits the rate at which bytes are transferred.
+ *
+ * Tokens (bytes) accumulate at `rate()` bytes per second up to a burst of
+ * `burst_window` worth of them. A transfer may start as long as there are
+ * tokens left, and it consumes as many tokens as bytes it moves, possibly
+ * leaving the bucket in debt. This enforces the rate exactly on average,
+ * regardless of the size of each transfer. The bucket never blocks: callers
+ * check `ready()` and use `delay()` to find out how long they must wait.
+ */
+class token_bucket {
+
+public:
+    using clock = std::chrono::steady_clock;
+
+    static constexpr std::chrono::milliseconds burst_window{10};
+
+    // A `rate` of 0 means no limit
+    explicit token_bucket(std::uint64_t rate = 0);
+
+    std::uint64_t
+    rate() const noexcept;
+
+    // Change the rate. Any outstanding debt is kept in bytes, so it is
+    // repaid at the new rate
+    void
+    set_rate(std::uint64_t rate);
+
+    // Whether a transfer can start now
+    bool
+    ready();
+
+    // Time left until a transfer can start
+    std::chrono::nanoseconds
+    delay();
+
+    // Take `bytes` tokens from the bucket
+    void
+    consume(std::size_t bytes);
+
+private:
+    void
+    refill(clock::time_point now);
+
+    std::uint64_t m_rate;
+    double m_capacity;
+    double m_tokens;
+    clock::time_point m_last;
+};
+
+} // namespace cargo
+
+#endif // CARGO_WORKER_TOKEN_BUCKET_HPP
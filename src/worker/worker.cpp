@@ -22,6 +22,7 @@
  * SPDX-License-Identifier: GPL-3.0-or-later
  *****************************************************************************/
 
+#include <algorithm>
 #include <thread>
 #include <fmt/format.h>
 #include <logger/logger.hpp>
@@ -29,6 +30,7 @@
 #include <boost/mpi/error_string.hpp>
 
 #include "worker.hpp"
+#include "batch.hpp"
 #include "fmt_formatters.hpp"
 
 namespace mpi = boost::mpi;
@@ -36,6 +38,13 @@ using namespace std::chrono_literals;
 
 namespace {
 
+// Maximum time spent progressing operations before checking for new messages
+constexpr auto progress_budget = 10ms;
+
+// Maximum time to idle while all operations are throttled, so that changes
+// to their rate limits are applied promptly
+constexpr auto max_throttle_wait = 1ms;
+
 // boost MPI doesn't have a communicator constructor that uses
 // MPI_Comm_create_group()
 mpi::communicator
@@ -51,17 +60,6 @@ make_communicator(const mpi::communicator& comm, const mpi::group& group,
     return mpi::communicator{newcomm, boost::mpi::comm_take_ownership};
 }
 
-void
-update_state(int rank, std::uint64_t tid, std::uint32_t seqno, std::string name,
-             cargo::transfer_state st, float bw,
-             std::optional<cargo::error_code> ec = std::nullopt) {
-
-    mpi::communicator world;
-    const cargo::status_message m{tid, seqno, name, st, bw, ec};
-    LOGGER_DEBUG("msg <= to: {} body: {{payload: {}}}", rank, m);
-    world.send(rank, static_cast<int>(cargo::tag::status), m);
-}
-
 } // namespace
 
 namespace cargo {
@@ -79,6 +77,227 @@ worker::set_block_size(std::uint64_t block_size) {
     m_block_size = block_size;
 }
 
+void
+worker::set_memory_limit(std::uint64_t memory_limit) {
+    m_memory_limit = memory_limit;
+}
+
+void
+worker::set_pipeline_depth(std::size_t pipeline_depth) {
+    m_pipeline_depth = pipeline_depth;
+}
+
+void
+worker::set_io_threads(std::size_t io_threads) {
+    m_io_threads = io_threads;
+}
+
+void
+worker::set_io_uring(bool enable) {
+    m_io_uring = enable;
+}
+
+void
+worker::set_incremental(bool enable) {
+    m_incremental = enable;
+}
+
+void
+worker::set_verify(bool enable) {
+    m_verify = enable;
+}
+
+void
+worker::set_compression(bool enable) {
+    m_compression = enable;
+}
+
+void
+worker::set_journal_dir(std::filesystem::path dir) {
+    m_journal_dir = std::move(dir);
+}
+
+void
+worker::set_mpio_hints(cargo::mpio_hints hints) {
+    m_mpio_hints = std::move(hints);
+}
+
+void
+worker::set_status_tree_arity(std::size_t arity) {
+    m_status_tree_arity = arity;
+}
+
+void
+worker::add_transfer(const boost::mpi::communicator& workers, int source,
+                     tag t, const transfer_message& m) {
+
+    // the master may choose a block size for each file
+    const auto block_size = m.block_size() != 0 ? m.block_size() : m_block_size;
+    const auto [it, inserted] = m_ops.emplace(std::make_pair(
+            make_pair(m.input_path(), m.output_path()),
+            make_pair(operation::make_operation(t, workers, m.input_path(),
+                                                m.output_path(), block_size,
+                                                m.i_type(), m.o_type()),
+                      -1)));
+
+    const auto op = it->second.first.get();
+
+    op->set_comm(source, m.tid(), m.seqno(), t);
+
+    if(inserted && op->collective()) {
+        m_collective_ops.push_back(it->first);
+    }
+    op->set_memory_limit(m_memory_limit);
+    op->set_pipeline_depth(m_pipeline_depth);
+    op->set_io_pool(m_io_pool);
+    op->set_datatype_cache(m_datatypes);
+    op->set_status_reporter(m_status_reporter);
+    op->set_io_uring(m_io_uring);
+    op->set_incremental(m_incremental);
+    op->set_verify(m_verify);
+    op->set_compression(m_compression);
+    op->set_journal_dir(m_journal_dir);
+
+    // the hints of the transfer are applied last, so that they
+    // override those of the server
+    auto hints = m_mpio_hints;
+    hints.insert(hints.end(), m.hints().begin(), m.hints().end());
+    op->set_mpio_hints(std::move(hints));
+    op->set_rate_limiter(rate_limiter(m.tid()));
+    op->set_chunk_blocks(m.chunk_blocks());
+
+    op->update_state(transfer_state::pending, -1.0f);
+}
+
+bool
+worker::progress_operation(cargo::operation& op, int& index) {
+
+    if(index == -1) {
+        // operation not started
+        op.update_state(transfer_state::running, -1.0f);
+        cargo::error_code ec = op();
+        if(ec != cargo::error_code::transfer_in_progress) {
+            op.update_state(transfer_state::failed, -1.0f, ec);
+            return false;
+        }
+
+        index = 0;
+    }
+
+    // Operation in progress
+    const int previous_index = index;
+    index = op.progress(index);
+
+    if(index == -1) {
+        // operation finished
+        cargo::error_code ec = op.progress();
+        op.update_state(ec ? transfer_state::failed
+                           : transfer_state::completed,
+                        0.0f, ec);
+        return false;
+    }
+
+    // update only if BW is set and the operation moved forward (it may have
+    // been throttled)
+    if(index != previous_index && op.bw() > 0.0f) {
+        op.update_state(transfer_state::running, op.bw());
+    }
+
+    return true;
+}
+
+std::chrono::nanoseconds
+worker::progress_operations() {
+
+    const auto deadline = std::chrono::steady_clock::now() + progress_budget;
+
+    // resume right after the operation that was served last
+    auto it = m_last_op ? m_ops.upper_bound(*m_last_op) : m_ops.begin();
+
+    // operations visited in a row without making any progress, and the
+    // shortest time until one of them can move data again
+    std::size_t stalled = 0;
+    auto idle = std::chrono::nanoseconds::max();
+
+    while(!m_ops.empty() && std::chrono::steady_clock::now() < deadline &&
+          stalled < m_ops.size()) {
+
+        if(it == m_ops.end()) {
+            it = m_ops.begin();
+        }
+
+        auto& [key, entry] = *it;
+        auto& [op, index] = entry;
+
+        if(!op) {
+            it = m_ops.erase(it);
+            continue;
+        }
+
+        // collective operations are only progressed in arrival order, since
+        // all workers must issue their collective calls in the same sequence
+        if(op->collective() && m_collective_ops.front() != key) {
+            ++stalled;
+            ++it;
+            continue;
+        }
+
+        m_last_op = key;
+
+        const int previous_index = index;
+
+        if(progress_operation(*op, index)) {
+            if(index == previous_index) {
+                ++stalled;
+                idle = std::min(idle, op->throttle_delay());
+            } else {
+                stalled = 0;
+                idle = std::chrono::nanoseconds::max();
+            }
+            ++it;
+            continue;
+        }
+
+        stalled = 0;
+        idle = std::chrono::nanoseconds::max();
+
+        // Transfer finished
+        if(op->collective()) {
+            m_collective_ops.pop_front();
+        }
+
+        it = m_ops.erase(it);
+    }
+
+    // only idle after a full round without progress
+    if(m_ops.empty() || stalled < m_ops.size() ||
+       idle == std::chrono::nanoseconds::max()) {
+        return std::chrono::nanoseconds::zero();
+    }
+
+    return idle;
+}
+
+std::shared_ptr<token_bucket>
+worker::rate_limiter(std::uint64_t tid) {
+
+    // forget the limiters of transfers without operations left
+    std::erase_if(m_rate_limiters,
+                  [](const auto& entry) { return entry.second.expired(); });
+
+    auto& limiter = m_rate_limiters[tid];
+
+    if(auto l = limiter.lock()) {
+        return l;
+    }
+
+    const auto it = m_rate_limits.find(tid);
+    auto l = std::make_shared<token_bucket>(
+            it != m_rate_limits.end() ? it->second : 0);
+    limiter = l;
+    return l;
+}
+
 int
 worker::run() {
 
@@ -105,66 +324,44 @@ worker::run() {
     LOGGER_INFO(greeting);
     LOGGER_INFO("{:=>{}}", "", greeting.size());
 
+    m_io_pool = std::make_shared<io_pool>(m_io_threads);
+    m_datatypes = std::make_shared<datatype_cache>();
+    m_status_reporter = std::make_shared<status_reporter>();
+
+    if(m_status_tree_arity != 0 && world.size() > 2) {
+        m_status_reporter->reduce_through(status_tree{
+                static_cast<std::size_t>(world.size() - 1),
+                static_cast<std::size_t>(world.rank() - 1),
+                m_status_tree_arity});
+    }
+
     bool done = false;
     while(!done) {
         // Always loop pending operations
-
-        auto I = m_ops.begin();
-        auto IE = m_ops.end();
-        if(I != IE) {
-            auto op = I->second.first.get();
-            int index = I->second.second;
-            if(op) {
-                if(index == -1) {
-                    // operation not started
-                    // Print error message
-                    update_state(op->source(), op->tid(), op->seqno(),
-                                 op->output_path(), transfer_state::running,
-                                 -1.0f);
-                    cargo::error_code ec = (*op)();
-                    if(ec != cargo::error_code::transfer_in_progress) {
-                        update_state(op->source(), op->tid(), op->seqno(),
-                                     op->output_path(), transfer_state::failed,
-                                     -1.0f, ec);
-                        I = m_ops.erase(I);
-                        break;
-                    }
-
-                    index = 0;
-                }
-                // Operation in progress
-                index = op->progress(index);
-                if(index == -1) {
-                    // operation finished
-                    cargo::error_code ec = op->progress();
-                    update_state(op->source(), op->tid(), op->seqno(),
-                                 op->output_path(),
-                                 ec ? transfer_state::failed
-                                    : transfer_state::completed,
-                                 0.0f, ec);
-
-                    // Transfer finished
-                    I = m_ops.erase(I);
-                } else {
-                    // update only if BW is set
-                    if(op->bw() > 0.0f) {
-                        update_state(op->source(), op->tid(), op->seqno(),
-                                     op->output_path(), transfer_state::running,
-                                     op->bw());
-                    }
-                    I->second.second = index;
-                    ++I;
-                }
-            }
+        const auto idle = progress_operations();
+
+        m_status_reporter->retire();
+
+        // without pending operations there is nothing to do until the next
+        // message arrives, so block until it does once the master knows the
+        // state of all of them. Otherwise, only check for messages between
+        // the blocks of the operations
+        if(m_ops.empty()) {
+            m_status_reporter->flush();
+        } else {
+            m_status_reporter->flush_due();
         }
 
-
-        auto msg = world.iprobe();
+        const auto msg = m_ops.empty()
+                                 ? boost::make_optional(world.probe())
+                                 : world.iprobe();
 
         if(!msg) {
-            // Only wait if there are no pending operations and no messages
-            if(m_ops.size() == 0) {
-                std::this_thread::sleep_for(10ms);
+            if(idle > std::chrono::nanoseconds::zero()) {
+                // all operations are throttled
+                std::this_thread::sleep_for(
+                        std::min<std::chrono::nanoseconds>(idle,
+                                                           max_throttle_wait));
             }
             continue;
         }
@@ -180,22 +377,54 @@ worker::run() {
                 transfer_message m;
                 world.recv(msg->source(), msg->tag(), m);
                 LOGGER_INFO("msg => from: {} body: {}", msg->source(), m);
-                m_ops.emplace(std::make_pair(
-                        make_pair(m.input_path(), m.output_path()),
-                        make_pair(operation::make_operation(
-                                          t, workers, m.input_path(),
-                                          m.output_path(), m_block_size,
-                                          m.i_type(), m.o_type()),
-                                  -1)));
+                add_transfer(workers, msg->source(), t, m);
+                break;
+            }
+
+            case tag::transfer_list: {
+                transfer_list_message m;
+                world.recv(msg->source(), msg->tag(), m);
+                LOGGER_INFO("msg => from: {} body: {}", msg->source(), m);
+
+                // every worker receives the same list, so collective
+                // operations are still queued in the same order by all of them
+                for(std::size_t i = 0; i < m.size(); ++i) {
+                    LOGGER_DEBUG("transfer => {}", m.transfers()[i]);
+                    add_transfer(workers, msg->source(), m.tag_of(i),
+                                 m.transfers()[i]);
+                }
+                break;
+            }
+
+            case tag::batch: {
+                batch_message m;
+                world.recv(msg->source(), msg->tag(), m);
+                LOGGER_INFO("msg => from: {} body: {}", msg->source(), m);
 
-                const auto op =
-                        m_ops[make_pair(m.input_path(), m.output_path())]
-                                .first.get();
+                if(m.size() == 0) {
+                    break;
+                }
 
-                op->set_comm(msg->source(), m.tid(), m.seqno(), t);
+                const auto block_size =
+                        m.block_size() != 0 ? m.block_size() : m_block_size;
+                const auto [it, inserted] = m_ops.emplace(std::make_pair(
+                        make_pair(fmt::format("batch:{}", m.tid()),
+                                  fmt::format("{}", m.seqnos().front())),
+                        make_pair(std::make_unique<batch_operation>(
+                                          m, block_size),
+                                  -1)));
 
-                update_state(op->source(), op->tid(), op->seqno(),
-                             op->output_path(), transfer_state::pending, -1.0f);
+                const auto op = it->second.first.get();
+
+                op->set_comm(msg->source(), m.tid(), m.seqnos().front(), t);
+                op->set_memory_limit(m_memory_limit);
+                op->set_pipeline_depth(m_pipeline_depth);
+                op->set_io_pool(m_io_pool);
+                op->set_io_uring(m_io_uring);
+                op->set_incremental(m_incremental);
+                op->set_verify(m_verify);
+                op->set_compression(m_compression);
+                op->set_rate_limiter(rate_limiter(m.tid()));
                 break;
             }
 
@@ -215,6 +444,58 @@ worker::run() {
             }
 
 
+            case tag::bw_limit: {
+                bw_limit_message m;
+                world.recv(msg->source(), msg->tag(), m);
+                LOGGER_INFO("msg => from: {} body: {}", msg->source(), m);
+
+                if(m.bytes_per_second() == 0) {
+                    m_rate_limits.erase(m.tid());
+                } else {
+                    m_rate_limits[m.tid()] = m.bytes_per_second();
+                }
+
+                if(const auto it = m_rate_limiters.find(m.tid());
+                   it != m_rate_limiters.end()) {
+                    if(const auto limiter = it->second.lock()) {
+                        limiter->set_rate(m.bytes_per_second());
+                    }
+                }
+                break;
+            }
+
+            case tag::status_report: {
+                // the updates of the subtree of a child, to be reduced with
+                // those of this worker
+                status_report_message m;
+                world.recv(msg->source(), msg->tag(), m);
+                LOGGER_DEBUG("msg => from: {} body: {}", msg->source(), m);
+                m_status_reporter->merge(msg->source(), m);
+                break;
+            }
+
+            case tag::grant: {
+                grant_message m;
+                world.recv(msg->source(), msg->tag(), m);
+                LOGGER_DEBUG("msg => from: {} body: {}", msg->source(), m);
+
+                const auto it = std::find_if(
+                        m_ops.begin(), m_ops.end(), [&](const auto& entry) {
+                            const auto& op = entry.second.first;
+                            return op && !op->collective() &&
+                                   op->tid() == m.tid() &&
+                                   op->seqno() == m.seqno();
+                        });
+
+                if(it == m_ops.end()) {
+                    LOGGER_WARN("No operation for grant {}", m);
+                    break;
+                }
+
+                it->second.first->grant_blocks(m.first_block(), m.count());
+                break;
+            }
+
             case tag::shutdown:
                 LOGGER_INFO("msg => from: {} body: {{shutdown}}",
                             msg->source());
@@ -229,6 +510,9 @@ worker::run() {
         }
     }
 
+    m_status_reporter->flush();
+    m_status_reporter->wait();
+
     LOGGER_INFO("Entering exit barrier...");
     world.barrier();
     LOGGER_INFO("Exit");
@@ -27,6 +27,7 @@
 #define CARGO_WORKER_HPP
 
 #include "proto/mpi/message.hpp"
+#include <deque>
 #include <map>
 #include "ops.hpp"
 namespace cargo {
@@ -41,15 +42,102 @@ public:
     void
     set_block_size(std::uint64_t block_size);
 
+    void
+    set_memory_limit(std::uint64_t memory_limit);
+
+    void
+    set_pipeline_depth(std::size_t pipeline_depth);
+
+    void
+    set_io_threads(std::size_t io_threads);
+
+    void
+    set_io_uring(bool enable);
+
+    void
+    set_incremental(bool enable);
+
+    void
+    set_verify(bool enable);
+
+    void
+    set_compression(bool enable);
+
+    void
+    set_journal_dir(std::filesystem::path dir);
+
+    // MPI-IO hints for all the collective transfers, which transfers may
+    // override with their own
+    void
+    set_mpio_hints(cargo::mpio_hints hints);
+
+    // Report the status of the transfers to the master through a tree of
+    // workers with this arity, which reduce the updates of their subtrees.
+    // 0 means that each worker reports directly to the master
+    void
+    set_status_tree_arity(std::size_t arity);
+
     int
     run();
 
 private:
+    using operation_key = std::pair<std::string, std::string>;
+
+    // Advance the active operations in round-robin order, one step each,
+    // until the time budget for this tick is exhausted or no operations
+    // remain. Returns how long the worker may idle because all the
+    // operations are throttled (zero if some operation made progress)
+    std::chrono::nanoseconds
+    progress_operations();
+
+    // The rate limiter shared by the operations of transfer `tid`
+    std::shared_ptr<token_bucket>
+    rate_limiter(std::uint64_t tid);
+
+    // Create the operation for transfer `m`, sent by rank `source` with tag
+    // `t`, and queue it
+    void
+    add_transfer(const boost::mpi::communicator& workers, int source, tag t,
+                 const transfer_message& m);
+
+    // Advance `op` by one step. Returns false once the operation has finished
+    // (successfully or not) and can be discarded
+    bool
+    progress_operation(cargo::operation& op, int& index);
+
     std::map<std::pair <std::string, std::string>, std::pair< std::unique_ptr<cargo::operation>, int> > m_ops;
+    // Collective operations in arrival order. Only the oldest one is
+    // progressed so that all workers enter their collective calls in the
+    // same order
+    std::deque<operation_key> m_collective_ops;
+    // Last operation progressed, so that the next tick resumes after it
+    std::optional<operation_key> m_last_op;
     std::string m_name;
     int m_rank;
     std::optional<std::filesystem::path> m_output_file;
     std::uint64_t m_block_size;
+    std::uint64_t m_memory_limit = 0;
+    std::size_t m_pipeline_depth = 4;
+    std::size_t m_io_threads = 4;
+    bool m_io_uring = true;
+    bool m_incremental = false;
+    bool m_verify = false;
+    bool m_compression = false;
+    std::filesystem::path m_journal_dir;
+    cargo::mpio_hints m_mpio_hints;
+    std::size_t m_status_tree_arity = 0;
+    std::shared_ptr<io_pool> m_io_pool;
+    // Datatypes of the collective operations, freed along with the worker
+    // before MPI is finalized
+    std::shared_ptr<datatype_cache> m_datatypes;
+    // Coalesces the status updates of the operations sent to the master
+    std::shared_ptr<status_reporter> m_status_reporter;
+    // Rate limiters of the transfers with active operations in this worker
+    std::map<std::uint64_t, std::weak_ptr<token_bucket>> m_rate_limiters;
+    // Rates requested for each transfer, applied to its limiters when they
+    // are created, since limits may arrive before or between the operations
+    // of the transfer
+    std::map<std::uint64_t, std::uint64_t> m_rate_limits;
  
 };
 
@@ -0,0 +1,108 @@
+/******************************************************************************
+ * Copyright 2021-2023, Barcelona Supercomputing Center (BSC), Spain
+ *
+ * This software was partially supported by the EuroHPC-funded project ADMIRE
+ *   (Project ID: 956748, https://www.admire-eurohpc.eu).
+ *
+ * This file is part of scord.
+ *
+ * scord is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * scord is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with scord.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *****************************************************************************/
+
+
+#include <catch2/catch_test_macros.hpp>
+#include <posix_file/file.hpp>
+#include <posix_file/container.hpp>
+#include <cstdlib>
+#include <filesystem>
+#include <memory>
+#include <unistd.h>
+#include "worker/io_pool.hpp"
+#include "worker/pipeline.hpp"
+
+SCENARIO("Skipping blocks in a block pipeline", "[worker][pipeline]") {
+
+    using posix_file::ranges::range;
+
+    GIVEN("A pipeline without verification") {
+
+        constexpr std::size_t depth = 4;
+        constexpr std::size_t block_size = 512;
+
+        cargo::block_pipeline pipeline{std::make_shared<cargo::io_pool>(1),
+                                       depth, block_size};
+
+        char name[] = "pipeline_tests_XXXXXX";
+        const int fd = mkstemp(name);
+        REQUIRE(fd != -1);
+        ::close(fd);
+
+        const auto out = posix_file::open(name, O_RDWR, 0,
+                                          cargo::FSPlugin::type::posix);
+
+        THEN("Skipped and resumed blocks complete in order with no data") {
+            // more blocks than slots, so that every slot is reused
+            for(std::size_t i = 0; i < 4 * depth; ++i) {
+                const range r{i * block_size, block_size};
+
+                if(i % 2 == 0) {
+                    pipeline.skip(r);
+                } else {
+                    pipeline.issue_resumed(out, r);
+                }
+
+                const auto block = pipeline.wait();
+                REQUIRE(block.skipped);
+                REQUIRE(block.bytes == 0);
+                REQUIRE(block.range == r);
+            }
+
+            REQUIRE(pipeline.empty());
+        }
+
+        std::filesystem::remove(name);
+    }
+}
+
+SCENARIO("Decompressing a truncated container", "[worker][pipeline]") {
+
+    using posix_file::block_container;
+    using posix_file::ranges::range;
+
+    GIVEN("A container whose last slots are missing from its file") {
+
+        const block_container c{3 * 4096, 4096 + block_container::header_size};
+
+        cargo::block_pipeline pipeline{std::make_shared<cargo::io_pool>(1), 2,
+                                       c.block_size()};
+
+        char name[] = "pipeline_tests_XXXXXX";
+        const int fd = mkstemp(name);
+        REQUIRE(fd != -1);
+        ::close(fd);
+
+        const auto f = posix_file::open(name, O_RDWR, 0,
+                                        cargo::FSPlugin::type::posix);
+
+        THEN("Extracting a block from a missing slot fails") {
+            pipeline.issue_decompress(f, c.block_size(), f, c,
+                                      range{2 * 4096, 4096});
+            REQUIRE_THROWS_AS(pipeline.wait(), posix_file::io_error);
+        }
+
+        std::filesystem::remove(name);
+    }
+}
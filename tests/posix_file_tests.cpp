@@ -27,8 +27,15 @@
 #define POSIX_FILE_HAVE_FMT
 #include <posix_file/file.hpp>
 #include <posix_file/views.hpp>
+#include <posix_file/block_plan.hpp>
+#include <posix_file/extents.hpp>
+#include <posix_file/checksum.hpp>
+#include <posix_file/container.hpp>
+#include <posix_file/journal.hpp>
+#include <posix_file/io_queue.hpp>
 #include <algorithm>
 #include <utility>
+#include <sys/stat.h>
 #include "catch2/generators/catch_generators_range.hpp"
 
 using posix_file::views::all_of;
@@ -3192,3 +3199,359 @@ SCENARIO("Iterating over a file region in block units with stride",
         }
     }
 }
+
+SCENARIO("Computing a strided block plan for a file",
+         "[posix_file][block_plan]") {
+
+    const std::size_t block_size = 512;
+    const std::size_t step = GENERATE(Catch::Generators::range(1, 50));
+    const std::size_t disp = GENERATE(Catch::Generators::range(0, 10));
+    CAPTURE(block_size, step, disp);
+
+    GIVEN("An empty file") {
+
+        const posix_file::block_plan plan{0, block_size, step, disp};
+
+        THEN("The plan is empty") {
+            REQUIRE(plan.empty());
+            REQUIRE(plan.total_blocks() == 0);
+        }
+    }
+
+    GIVEN("A non-empty file") {
+
+        const std::size_t file_size =
+                GENERATE(block_size / 3, block_size, block_size * 3 / 2,
+                         8 * block_size, 11 * block_size + 7);
+        CAPTURE(file_size);
+
+        auto f = create_temporary_file(file_size);
+        const posix_file::block_plan plan{f.size(), block_size, step, disp};
+
+        WHEN("Accessing each block of the plan") {
+            std::vector<posix_file::ranges::range> ranges;
+            for(std::size_t k = 0; k < plan.size(); ++k) {
+                ranges.push_back(plan[k]);
+            }
+
+            THEN("The same ranges as the strided view are returned") {
+                std::vector<posix_file::ranges::range> expected_ranges;
+                for(const auto& r :
+                    all_of(f) | as_blocks(block_size) | strided(step, disp)) {
+                    expected_ranges.push_back(r);
+                }
+                REQUIRE(ranges == expected_ranges);
+            }
+        }
+    }
+}
+
+SCENARIO("Trimming blocks to the data extents of a file",
+         "[posix_file][extents]") {
+
+    using posix_file::ranges::range;
+
+    GIVEN("A file without data") {
+
+        const posix_file::extent_map m{};
+
+        THEN("Every block is a hole") {
+            REQUIRE(m.data_size() == 0);
+            REQUIRE_FALSE(m.data_in(range{0, 512}).has_value());
+        }
+    }
+
+    GIVEN("A sparse file") {
+
+        // data in [1024, 1536) and [3000, 3100)
+        const posix_file::extent_map m{
+                {range{1024, 512}, range{3000, 100}}};
+
+        THEN("The size of its data is the size of its extents") {
+            REQUIRE(m.data_size() == 612);
+        }
+
+        THEN("Blocks in holes have no data") {
+            REQUIRE_FALSE(m.data_in(range{0, 1024}).has_value());
+            REQUIRE_FALSE(m.data_in(range{1536, 1464}).has_value());
+            REQUIRE_FALSE(m.data_in(range{3100, 512}).has_value());
+        }
+
+        THEN("Blocks are trimmed to the data they contain") {
+            REQUIRE(m.data_in(range{0, 2048}) == range{1024, 512});
+            REQUIRE(m.data_in(range{1280, 512}) == range{1280, 256});
+            REQUIRE(m.data_in(range{1024, 4096}) == range{1024, 2076});
+            REQUIRE(m.data_in(range{3050, 512}) == range{3050, 50});
+        }
+    }
+}
+
+SCENARIO("Checksumming the blocks of a file", "[posix_file][checksum]") {
+
+    using posix_file::crc32c;
+    using posix_file::ranges::range;
+
+    GIVEN("A well-known input") {
+
+        const std::string data{"123456789"};
+
+        THEN("Its CRC32C is the standard check value") {
+            REQUIRE(crc32c(0, data.data(), data.size()) == 0xe3069283);
+            REQUIRE(crc32c(0, data.data(), 0) == 0);
+        }
+    }
+
+    GIVEN("A buffer split in blocks") {
+
+        std::vector<unsigned char> data(100 * 1024 + 7);
+        std::generate(data.begin(), data.end(),
+                      [n = 0u]() mutable { return (n++ * 31) % 251; });
+
+        const auto expected = crc32c(0, data.data(), data.size());
+
+        THEN("Extending a checksum is equivalent to a single pass") {
+            const auto crc = crc32c(0, data.data(), 4097);
+            REQUIRE(crc32c(crc, data.data() + 4097, data.size() - 4097) ==
+                    expected);
+        }
+
+        THEN("The digest of its blocks is independent of their order") {
+            constexpr std::size_t block_size = 4096;
+            posix_file::file_digest even{data.size()};
+            posix_file::file_digest odd{data.size()};
+
+            for(std::size_t i = 0, k = 0; i < data.size();
+                i += block_size, ++k) {
+                const auto n = std::min(block_size, data.size() - i);
+                auto& d = k % 2 == 0 ? even : odd;
+                d.add(range{i, n}, crc32c(0, data.data() + i, n));
+            }
+
+            odd.merge(even.value());
+            REQUIRE(odd.value() == expected);
+        }
+    }
+
+    GIVEN("A hole") {
+
+        const std::vector<char> zeros(5000);
+
+        THEN("Its checksum needs no data") {
+            posix_file::file_digest d{zeros.size()};
+            d.add_zeros(range{0, zeros.size()});
+            REQUIRE(d.value() == crc32c(0, zeros.data(), zeros.size()));
+        }
+    }
+
+    GIVEN("A sparse file") {
+
+        constexpr std::size_t file_size = 256 * 1024;
+        constexpr std::size_t block_size = 16 * 1024;
+
+        auto f = create_temporary_file(file_size);
+        const auto fd = posix_file::open(f.path(), O_RDWR, 0,
+                                         cargo::FSPlugin::type::posix);
+
+        // data in a few blocks, the first one partially
+        std::vector<char> data(40 * 1024);
+        std::generate(data.begin(), data.end(),
+                      [n = 0u]() mutable { return (n++ * 31) % 251; });
+        fd.pwrite(data, 20 * 1024, data.size());
+        fd.pwrite(data, 200 * 1024, 1000);
+
+        std::vector<char> contents(file_size);
+        fd.pread(contents, 0, contents.size());
+        const auto expected = crc32c(0, contents.data(), contents.size());
+
+        THEN("The digest of its data and holes is the checksum of the file") {
+            const auto extents = fd.extents();
+            posix_file::file_digest d{file_size};
+
+            for(std::size_t i = 0; i < file_size; i += block_size) {
+                const range block{i, block_size};
+                const auto in = extents.data_in(block);
+
+                if(!in) {
+                    d.add_zeros(block);
+                    continue;
+                }
+
+                const auto begin = static_cast<std::size_t>(in->offset());
+                const auto end = begin + in->size();
+
+                if(begin > i) {
+                    d.add_zeros(range{i, begin - i});
+                }
+
+                if(i + block_size > end) {
+                    d.add_zeros(range{end, i + block_size - end});
+                }
+
+                d.add(*in, crc32c(0, contents.data() + begin, in->size()));
+            }
+
+            REQUIRE(d.value() == expected);
+        }
+    }
+}
+
+SCENARIO("Packing the blocks of a file in a container",
+         "[posix_file][container]") {
+
+    using posix_file::block_container;
+    using posix_file::ranges::range;
+
+    GIVEN("A file with compressible and random blocks") {
+
+        const block_container c{3 * 4096 + 100, 4096 + 64};
+
+        std::vector<char> data(c.file_size());
+        std::generate(data.begin(), data.begin() + 4096,
+                      [n = 0u]() mutable { return n++ % 7; });
+        std::generate(data.begin() + 4096, data.end(), [n = 1u]() mutable {
+            n = n * 1103515245 + 12345;
+            return static_cast<char>(n >> 16);
+        });
+
+        THEN("Each block is stored in its own slot") {
+            REQUIRE(c.payload_size() == 4096);
+            REQUIRE(c.capacity() == 4 * c.block_size());
+            REQUIRE(c.slot(range{2 * 4096, 4096}) ==
+                    range{2 * c.block_size(), c.block_size()});
+        }
+
+        THEN("Every block can be extracted from its slot") {
+            for(std::size_t i = 0; i < data.size(); i += c.payload_size()) {
+                const range r{i, std::min(c.payload_size(), data.size() - i)};
+                std::vector<char> slot(c.block_size());
+                std::vector<char> block(r.size());
+
+                const auto n = c.pack(r, data.data() + i, slot.data(),
+                                      block_container::default_level);
+                REQUIRE(n <= c.block_size());
+
+                if(i == 0 && block_container::supported()) {
+                    REQUIRE(n < block_container::header_size + r.size());
+                }
+
+                c.unpack(r, slot.data(), n, block.data());
+                REQUIRE(std::equal(block.begin(), block.end(),
+                                   data.begin() + i));
+            }
+        }
+
+        THEN("A corrupt slot is detected") {
+            const range r{0, c.payload_size()};
+            std::vector<char> slot(c.block_size());
+            std::vector<char> block(r.size());
+
+            const auto n = c.pack(r, data.data(), slot.data(),
+                                  block_container::default_level);
+
+            REQUIRE_THROWS_AS(c.unpack(r, slot.data(), n - 1, block.data()),
+                              posix_file::io_error);
+        }
+    }
+}
+
+SCENARIO("Resuming a transfer from its completion journal",
+         "[posix_file][journal]") {
+
+    using posix_file::completion_journal;
+    using posix_file::ranges::range;
+
+    GIVEN("A journal of the first blocks of a file") {
+
+        char name[] = "posix_file_tests_journal_XXXXXX";
+        REQUIRE(mkdtemp(name) != nullptr);
+        const std::filesystem::path dir{name};
+
+        auto f = create_temporary_file(3000);
+        const auto output = posix_file::open(f.path(), O_RDWR, 0,
+                                             cargo::FSPlugin::type::posix);
+        auto input = create_temporary_file(3000);
+
+        completion_journal j{dir, f.path(), input, 3000, 512, 0};
+        j.complete(range{0, 512});
+        j.complete(range{512, 512});
+        j.complete(range{2048, 512});
+        j.flush(output);
+        j.complete(range{1024, 512});
+
+        THEN("A journal with larger blocks finds the blocks covered") {
+            const completion_journal r{dir, f.path(), input, 3000, 1024, 1};
+
+            REQUIRE(r.resumed() == 1);
+            REQUIRE(r.completed(range{0, 1024}));
+            REQUIRE_FALSE(r.completed(range{1024, 1024}));
+            REQUIRE_FALSE(r.completed(range{2048, 952}));
+        }
+
+        THEN("A journal of an input of another size finds no blocks") {
+            const completion_journal r{dir, f.path(), input, 4000, 512, 1};
+            REQUIRE(r.resumed() == 0);
+        }
+
+        THEN("A journal of another input finds no blocks") {
+            const auto other = create_temporary_file(3000);
+            const completion_journal r{dir, f.path(), other, 3000, 512, 1};
+            REQUIRE(r.resumed() == 0);
+        }
+
+        THEN("A journal of a modified input finds no blocks") {
+            const timespec times[2] = {{0, UTIME_OMIT}, {12345, 0}};
+            REQUIRE(utimensat(AT_FDCWD, input.path().c_str(), times, 0) == 0);
+
+            const completion_journal r{dir, f.path(), input, 3000, 512, 1};
+            REQUIRE(r.resumed() == 0);
+        }
+
+        THEN("No blocks are found once the journals are removed") {
+            completion_journal::remove(dir, f.path());
+            const completion_journal r{dir, f.path(), input, 3000, 512, 1};
+            REQUIRE(r.resumed() == 0);
+        }
+
+        std::filesystem::remove_all(dir);
+    }
+}
+
+SCENARIO("Reusing file descriptors in an I/O queue",
+         "[posix_file][io_queue]") {
+
+    GIVEN("A file written through a queue, then released and closed") {
+
+        posix_file::io_queue queue{4};
+        std::vector<char> data(4096, 'a');
+
+        auto first = create_temporary_file(data.size());
+        auto output = posix_file::open(first.path(), O_RDWR, 0,
+                                       cargo::FSPlugin::type::posix);
+        queue.wait(queue.write(output, data, 0, data.size()));
+        queue.release(output);
+        output.close();
+
+        WHEN("Another file is written through the same queue") {
+
+            auto second = create_temporary_file(data.size());
+            auto other = posix_file::open(second.path(), O_RDWR, 0,
+                                          cargo::FSPlugin::type::posix);
+            std::fill(data.begin(), data.end(), 'b');
+            queue.wait(queue.write(other, data, 0, data.size()));
+
+            THEN("Each file holds its own data") {
+                std::vector<char> buf(data.size());
+                const auto in = posix_file::open(
+                        first.path(), O_RDONLY, 0,
+                        cargo::FSPlugin::type::posix);
+                in.pread(buf, 0, buf.size());
+                REQUIRE(std::all_of(buf.begin(), buf.end(),
+                                    [](char c) { return c == 'a'; }));
+
+                other.pread(buf, 0, buf.size());
+                REQUIRE(std::all_of(buf.begin(), buf.end(),
+                                    [](char c) { return c == 'b'; }));
+            }
+        }
+    }
+}